@@ -0,0 +1,268 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+	Headless unpaced-mode (backpressure) check.
+
+	Each source runs unpaced on its own thread. It writes into a DataBuffer
+	sized the way SourceThread sizes it (--buffer-ms). A reader thread drains
+	every buffer at the nominal sample rate times --time-scale, as the GUI
+	would. APD adds an LFP band decimated from the AP band, so the decimator's
+	backpressure path is exercised as well.
+
+	Over the second half of the run each band must:
+	  - lose no samples: accepted timestamps stay consecutive and nothing overflows
+	  - have waited on the reader (blocked time > 0 for the generating band)
+	  - be accepted at the reader's rate, within BACKPRESSURE_RATE_TOLERANCE
+
+	Exits with 1 if any check fails.
+
+	Usage: SourceSimBackpressureTest [--sources AP,APD,LFP,AI] [--seconds 4] [--channels 384]
+	                                 [--buffer-ms 100] [--read-ms 10] [--time-scale 1]
+*/
+
+#include "SourceSim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+/* Largest relative difference between the accepted rate and the reader's rate once settled */
+#define BACKPRESSURE_RATE_TOLERANCE 0.01
+
+struct BackpressureOptions
+{
+	std::vector<std::string> sources = { "AP", "APD", "LFP", "AI" };
+	double seconds = 4.0;
+	int channels = 384;
+	float bufferMs = 100.0f;
+	int readMs = 10;
+	double timeScale = 1.0;
+};
+
+/* One band and the buffer it fills; the derived LFP band of APD is a second one */
+struct Band
+{
+	Band() : source(nullptr), rowsAtHalf(0), rowsAtEnd(0) {}
+
+	SourceSim* source;
+	ScopedPointer<DataBuffer> buffer;
+	SourceStats::Snapshot stats;
+	int64 rowsAtHalf;
+	int64 rowsAtEnd;
+};
+
+static std::vector<std::string> splitList(const char* text)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(text);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+
+	return items;
+}
+
+static SourceSim* createSource(const std::string& type, int numChannels)
+{
+	if (type == "AP" || type == "APD")
+	{
+		NPX_AP_BAND* apBand = new NPX_AP_BAND(numChannels, "AP");
+		apBand->setNoiseRms(10.0f);
+		return apBand;
+	}
+	else if (type == "LFP")
+	{
+		SourceSim* lfpBand = new NPX_LFP_BAND(numChannels);
+		lfpBand->setNoiseRms(5.0f);
+		return lfpBand;
+	}
+	else if (type == "AI")
+	{
+		return new NIDAQ(8);
+	}
+
+	return nullptr;
+}
+
+/* Drains every buffer at its nominal rate until told to stop, like the GUI's reader */
+static void drainBuffers(std::vector<Band*> bands, const BackpressureOptions& options,
+	steady_clock::time_point start, std::atomic<bool>& stop)
+{
+	std::vector<int64> numRead(bands.size(), 0);
+
+	while (!stop.load())
+	{
+		std::this_thread::sleep_for(milliseconds(options.readMs));
+
+		const double elapsed = duration<double>(steady_clock::now() - start).count();
+
+		//Whatever is due by now; rows the buffer could not supply yet are taken on a later pass
+		for (size_t b = 0; b < bands.size(); b++)
+		{
+			const int64 due = (int64) (elapsed * bands[b]->source->sampleRate * options.timeScale);
+			numRead[b] += bands[b]->buffer->readFromBuffer((int) jmin(due - numRead[b], (int64) INT32_MAX));
+		}
+	}
+}
+
+static bool runSource(const std::string& type, const BackpressureOptions& options)
+{
+
+	OwnedArray<SourceSim> sources;
+	std::vector<Band*> bands;
+	Band generated, derived;
+
+	generated.source = createSource(type, options.channels);
+
+	if (generated.source == nullptr)
+	{
+		std::cerr << "Unknown source type " << type << std::endl;
+		return false;
+	}
+
+	sources.add(generated.source);
+	bands.push_back(&generated);
+
+	if (type == "APD")
+	{
+		derived.source = new NPX_LFP_BAND(options.channels);
+		sources.add(derived.source);
+		bands.push_back(&derived);
+	}
+
+	//Buffers as SourceThread sizes them; the decimator takes the derived band's buffer when attached
+	for (size_t b = 0; b < bands.size(); b++)
+	{
+		SourceSim* source = bands[b]->source;
+
+		source->seed = (int) b + 1;
+		source->setTimeScale(options.timeScale);
+		bands[b]->buffer = new DataBuffer(source->numChannels, source->setBufferDuration(options.bufferMs));
+		source->buffer = bands[b]->buffer;
+	}
+
+	if (type == "APD")
+		generated.source->setDecimatedOutput(derived.source, 12);
+
+	generated.source->setUnpaced(true);
+
+	const steady_clock::time_point start = steady_clock::now();
+	std::atomic<bool> stop(false);
+	std::thread reader(drainBuffers, bands, std::cref(options), start, std::ref(stop));
+
+	generated.source->startThread();
+
+	//Settle for the first half, measure the accepted rate over the second
+	std::this_thread::sleep_for(duration<double>(options.seconds / 2.0));
+	const steady_clock::time_point half = steady_clock::now();
+
+	for (auto band : bands)
+		band->rowsAtHalf = band->buffer->getNumItems();
+
+	std::this_thread::sleep_for(duration<double>(options.seconds / 2.0));
+	const double window = duration<double>(steady_clock::now() - half).count();
+
+	//Counters are taken before stopping; the packet a blocked source abandons on exit does not count as lost
+	for (auto band : bands)
+	{
+		band->rowsAtEnd = band->buffer->getNumItems();
+		band->stats = band->source->stats.getSnapshot();
+	}
+
+	generated.source->stopThread(-1);
+	stop = true;
+	reader.join();
+
+	bool passed = true;
+
+	for (auto band : bands)
+	{
+		const double readerRate = band->source->sampleRate * options.timeScale;
+		const double acceptedRate = (double) (band->rowsAtEnd - band->rowsAtHalf) / window;
+		const double rateError = acceptedRate / readerRate - 1.0;
+		const bool isDerived = band == &derived;
+
+		const bool lossless = band->buffer->numLost == 0 && band->stats.overflowSamples == 0;
+		const bool blocked = isDerived || band->stats.blockedNs > 0;
+		const bool rateOk = std::abs(rateError) <= BACKPRESSURE_RATE_TOLERANCE;
+		const bool bandPassed = lossless && blocked && rateOk;
+
+		std::printf("%-4s %-4s %9.0f %11.1f %9.3f %10lld %10lld %9.1f %6lld %6s\n",
+			type.c_str(), isDerived ? "LFP" : "gen",
+			readerRate, acceptedRate, rateError * 100.0,
+			(long long) band->buffer->numItems, (long long) band->buffer->numLost,
+			(double) band->stats.blockedNs * 1e-6, (long long) band->stats.highWaterMark,
+			bandPassed ? "PASS" : "FAIL");
+
+		passed = passed && bandPassed;
+	}
+
+	return passed;
+
+}
+
+int main(int argc, char** argv)
+{
+
+	BackpressureOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--sources") && hasValue)
+			options.sources = splitList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--seconds") && hasValue)
+			options.seconds = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--channels") && hasValue)
+			options.channels = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--buffer-ms") && hasValue)
+			options.bufferMs = (float) std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--read-ms") && hasValue)
+			options.readMs = jmax(1, std::atoi(argv[++i]));
+		else if (!std::strcmp(argv[i], "--time-scale") && hasValue)
+			options.timeScale = jlimit(0.01, 100.0, std::atof(argv[++i]));
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--sources AP,APD,LFP,AI] [--seconds 4] [--channels 384]"
+				" [--buffer-ms 100] [--read-ms 10] [--time-scale 1]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::printf("%-4s %-4s %9s %11s %9s %10s %10s %9s %6s %6s\n",
+		"src", "band", "read Hz", "accepted Hz", "error %", "rows", "lost", "blocked ms", "hwm", "result");
+
+	bool passed = true;
+
+	for (auto& type : options.sources)
+		passed = runSource(type, options) && passed;
+
+	return passed ? 0 : 1;
+
+}
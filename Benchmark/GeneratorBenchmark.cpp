@@ -0,0 +1,255 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+	Headless generator throughput benchmark.
+
+	Runs each SourceSim generator flat out (no pacing) against a counting
+	DataBuffer for a matrix of channel counts and packet sizes, and reports
+	sample rows per second, ns per channel-sample, speed relative to real time,
+	CPU milliseconds per simulated second and heap allocations per packet.
+
+	APD is an AP band that also feeds a decimated LFP band (lfpFromAp). It is
+	not a saving: the 192-tap filter does 16 multiply-adds per input sample on
+	every channel, so APD costs several times the AP and LFP rows together.
+	Compare its ms/sim-s with their sum to see what coherence costs.
+
+	Usage: SourceSimBenchmark [--sources AP,LFP,APD,WB,AI,APT] [--channels 32,128,384,1536]
+	                          [--packets 64,500,2048] [--seconds 0.25] [--units 0] [--quantize]
+*/
+
+#include "SourceSim.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+
+static std::atomic<int64> numHeapAllocations(0);
+
+void* operator new(std::size_t size)
+{
+	numHeapAllocations++;
+
+	if (void* block = std::malloc(size ? size : 1))
+		return block;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept
+{
+	std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept
+{
+	std::free(block);
+}
+
+struct BenchmarkOptions
+{
+	std::vector<std::string> sources = { "AP", "LFP", "APD", "WB", "AI", "APT" };
+	std::vector<int> channels = { 32, 128, 384, 1536 };
+	std::vector<int> packetSizes = { 64, 500, 2048 };
+	double seconds = 0.25;
+	int units = 0;
+	bool quantize = false;
+};
+
+static std::vector<std::string> splitList(const char* text)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(text);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+
+	return items;
+}
+
+static std::vector<int> splitIntList(const char* text)
+{
+	std::vector<int> values;
+
+	for (auto& item : splitList(text))
+		values.push_back(std::atoi(item.c_str()));
+
+	return values;
+}
+
+/* Builds a source configured the way SourceThread::generateBuffers() sets it up */
+static SourceSim* createSource(const std::string& type, int numChannels, const BenchmarkOptions& options)
+{
+	SourceSim* source = nullptr;
+
+	if (type == "AP" || type == "APD")
+	{
+		NPX_AP_BAND* apBand = new NPX_AP_BAND(numChannels);
+		apBand->setNumUnits(options.units);
+		apBand->setNoiseRms(10.0f);
+		source = apBand;
+	}
+	else if (type == "WB")
+	{
+		//Wideband probe (NPX 2.0 / HD profiles): AP content plus the 1/f LFP background
+		NPX_AP_BAND* wideband = new NPX_AP_BAND(numChannels, "WB");
+		wideband->setNumUnits(options.units);
+		wideband->setNoiseRms(10.0f);
+		wideband->setColoredNoise(20.0f, 1.0f, 5.0f);
+		source = wideband;
+	}
+	else if (type == "LFP")
+	{
+		NPX_LFP_BAND* lfpBand = new NPX_LFP_BAND(numChannels);
+		lfpBand->setNoiseRms(5.0f);
+		lfpBand->setColoredNoise(20.0f, 1.0f, 5.0f);
+		source = lfpBand;
+	}
+	else if (type == "AI")
+	{
+		source = new NIDAQ(numChannels);
+	}
+	else if (type == "APT")
+	{
+		source = new APTrain(numChannels);
+	}
+
+	if (source != nullptr && options.quantize)
+		source->quantizer.setResolution(2.34375f, 10);
+
+	return source;
+}
+
+static void runCase(const std::string& type, int numChannels, int packetSize, const BenchmarkOptions& options)
+{
+
+	ScopedPointer<SourceSim> source = createSource(type, numChannels, options);
+
+	if (source == nullptr)
+	{
+		std::cerr << "Unknown source type " << type << std::endl;
+		return;
+	}
+
+	DataBuffer buffer(numChannels, 0);
+	source->buffer = &buffer;
+	source->seed = 1;
+	source->setPacketSize(packetSize);
+
+	//APD: the LFP band is decimated from this one (12:1) instead of being generated
+	ScopedPointer<SourceSim> derived;
+	DataBuffer derivedBuffer(numChannels, 0);
+
+	if (type == "APD")
+	{
+		derived = new NPX_LFP_BAND(numChannels);
+		derived->buffer = &derivedBuffer;
+		source->setDecimatedOutput(derived, 12);
+	}
+
+	source->beginAcquisition();
+
+	//Warm up caches, noise tables and spike state outside the timed region
+	for (int i = 0; i < 4; i++)
+		source->processPacket();
+
+	const int64 allocationsBefore = numHeapAllocations.load();
+	const int64 arenaAllocationsBefore = source->packet.getNumAllocations();
+	const int64 samplesBefore = source->numSamples;
+
+	int64 numPackets = 0;
+	double elapsed = 0;
+	const auto start = std::chrono::steady_clock::now();
+
+	do
+	{
+		//Check the clock every few packets so small packets are not dominated by timing overhead
+		for (int i = 0; i < 8; i++)
+			source->processPacket();
+
+		numPackets += 8;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	while (elapsed < options.seconds);
+
+	const int64 heapAllocations = numHeapAllocations.load() - allocationsBefore;
+	const int64 arenaAllocations = source->packet.getNumAllocations() - arenaAllocationsBefore;
+	const double rows = (double) (source->numSamples - samplesBefore);
+
+	source->endAcquisition();
+
+	std::printf("%-4s %6d %6d %12.0f %10.3f %9.1f %8.2f %10.3f %6lld\n",
+		type.c_str(), numChannels, packetSize,
+		rows / elapsed,
+		1e9 * elapsed / (rows * numChannels),
+		rows / elapsed / source->sampleRate,
+		1e3 * elapsed * source->sampleRate / rows,
+		(double) heapAllocations / (double) numPackets,
+		(long long) arenaAllocations);
+
+}
+
+int main(int argc, char** argv)
+{
+
+	BenchmarkOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--sources") && hasValue)
+			options.sources = splitList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--channels") && hasValue)
+			options.channels = splitIntList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--packets") && hasValue)
+			options.packetSizes = splitIntList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--seconds") && hasValue)
+			options.seconds = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--units") && hasValue)
+			options.units = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--quantize"))
+			options.quantize = true;
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--sources AP,LFP,APD,WB,AI,APT] [--channels 32,384] [--packets 64,500]"
+				" [--seconds 0.25] [--units N] [--quantize]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::printf("%-4s %6s %6s %12s %10s %9s %8s %10s %6s\n",
+		"src", "chans", "packet", "samples/s", "ns/ch-smp", "x real", "ms/sim-s", "allocs/pkt", "arena");
+
+	for (auto& type : options.sources)
+		for (int numChannels : options.channels)
+			for (int packetSize : options.packetSizes)
+				runCase(type, numChannels, packetSize, options);
+
+	return 0;
+
+}
@@ -0,0 +1,350 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __HEADLESS_DATATHREADHEADERS_H__
+#define __HEADLESS_DATATHREADHEADERS_H__
+
+/**
+
+	Minimal stand-in for the plugin API used by the generator sources, so they
+	can be built and timed without the Open Ephys GUI or JUCE.
+
+	Only what the generators, noise/spike engines and scheduler touch is
+	provided. DataBuffer counts what it is given instead of storing it; it
+	can be bounded and drained to exercise backpressure.
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int64_t int64;
+typedef uint64_t uint64;
+
+#define jassert(expression) assert(expression)
+#define JUCE_DECLARE_NON_COPYABLE(className) \
+	className(const className&) = delete; \
+	className& operator=(const className&) = delete;
+
+template <typename Type> Type jmin(Type a, Type b) { return b < a ? b : a; }
+template <typename Type> Type jmax(Type a, Type b) { return a < b ? b : a; }
+template <typename Type> Type jlimit(Type lower, Type upper, Type value) { return value < lower ? lower : (upper < value ? upper : value); }
+
+class String
+{
+public:
+	String() {}
+	String(const char* text) : text(text) {}
+	String(const std::string& text) : text(text) {}
+	String(int value) : text(std::to_string(value)) {}
+
+	String operator+(const String& other) const { return String(text + other.text); }
+	friend String operator+(const char* a, const String& b) { return String(a + b.text); }
+	bool operator==(const String& other) const { return text == other.text; }
+
+	const char* toRawUTF8() const { return text.c_str(); }
+
+	friend std::ostream& operator<<(std::ostream& stream, const String& string) { return stream << string.text; }
+
+private:
+	std::string text;
+};
+
+template <typename ObjectType>
+class ScopedPointer
+{
+public:
+	ScopedPointer(ObjectType* object = nullptr) : object(object) {}
+	ScopedPointer(ScopedPointer&& other) : object(other.release()) {}
+	~ScopedPointer() { delete object; }
+
+	ScopedPointer& operator=(ObjectType* newObject)
+	{
+		if (newObject != object)
+		{
+			delete object;
+			object = newObject;
+		}
+		return *this;
+	}
+
+	operator ObjectType*() const { return object; }
+	ObjectType* operator->() const { return object; }
+	ObjectType* get() const { return object; }
+	ObjectType* release() { ObjectType* released = object; object = nullptr; return released; }
+
+private:
+	ObjectType* object;
+
+	JUCE_DECLARE_NON_COPYABLE(ScopedPointer);
+};
+
+template <typename ElementType>
+class Array
+{
+public:
+	void add(const ElementType& element) { elements.push_back(element); }
+	void clear() { elements.clear(); }
+	int size() const { return (int) elements.size(); }
+	ElementType operator[](int index) const { return index >= 0 && index < size() ? elements[index] : ElementType(); }
+
+	const ElementType* begin() const { return elements.data(); }
+	const ElementType* end() const { return elements.data() + elements.size(); }
+
+private:
+	std::vector<ElementType> elements;
+};
+
+template <typename ObjectType>
+class OwnedArray
+{
+public:
+	ObjectType* add(ObjectType* object) { objects.emplace_back(object); return object; }
+	void clear() { objects.clear(); }
+	int size() const { return (int) objects.size(); }
+	ObjectType* operator[](int index) const { return index >= 0 && index < size() ? objects[index].get() : nullptr; }
+	ObjectType* getLast() const { return objects.empty() ? nullptr : objects.back().get(); }
+
+	struct Iterator
+	{
+		typename std::vector<std::unique_ptr<ObjectType>>::const_iterator position;
+		ObjectType* operator*() const { return position->get(); }
+		Iterator& operator++() { ++position; return *this; }
+		bool operator!=(const Iterator& other) const { return position != other.position; }
+	};
+
+	Iterator begin() const { return { objects.begin() }; }
+	Iterator end() const { return { objects.end() }; }
+
+private:
+	std::vector<std::unique_ptr<ObjectType>> objects;
+};
+
+class CriticalSection
+{
+public:
+	void enter() const { mutex.lock(); }
+	void exit() const { mutex.unlock(); }
+
+private:
+	mutable std::recursive_mutex mutex;
+};
+
+class ScopedLock
+{
+public:
+	ScopedLock(const CriticalSection& lock) : lock(lock) { lock.enter(); }
+	~ScopedLock() { lock.exit(); }
+
+private:
+	const CriticalSection& lock;
+};
+
+/* std::thread behind the subset of juce::Thread the sources and scheduler use */
+class Thread
+{
+public:
+	Thread(const String& name) : name(name), shouldExit(false), signalled(false) {}
+	virtual ~Thread() { stopThread(-1); }
+
+	virtual void run() = 0;
+
+	void startThread()
+	{
+		if (thread.joinable())
+			return;
+
+		shouldExit = false;
+		thread = std::thread([this] { current() = this; run(); });
+	}
+
+	void signalThreadShouldExit() { shouldExit = true; notify(); }
+	bool threadShouldExit() const { return shouldExit; }
+	bool isThreadRunning() const { return thread.joinable(); }
+
+	bool stopThread(int)
+	{
+		signalThreadShouldExit();
+
+		if (thread.joinable())
+			thread.join();
+
+		return true;
+	}
+
+	bool wait(int timeOutMilliseconds)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto woken = [this] { return signalled || shouldExit.load(); };
+
+		if (timeOutMilliseconds < 0)
+			condition.wait(lock, woken);
+		else
+			condition.wait_for(lock, std::chrono::milliseconds(timeOutMilliseconds), woken);
+
+		const bool wasSignalled = signalled;
+		signalled = false;
+		return wasSignalled;
+	}
+
+	void notify()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			signalled = true;
+		}
+		condition.notify_all();
+	}
+
+	/* Pinning is not emulated; the benchmark runs wherever the OS schedules it */
+	void setAffinityMask(uint32) {}
+
+	static void yield() { std::this_thread::yield(); }
+	static void sleep(int milliseconds) { std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds)); }
+
+	static bool currentThreadShouldExit()
+	{
+		return current() != nullptr && current()->threadShouldExit();
+	}
+
+private:
+	static Thread*& current()
+	{
+		static thread_local Thread* thread = nullptr;
+		return thread;
+	}
+
+	String name;
+	std::thread thread;
+	std::atomic<bool> shouldExit;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool signalled;
+};
+
+struct SystemStats
+{
+	static bool hasAVX2()
+	{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+};
+
+/* Counts what the sources hand over instead of storing it. With a size it behaves like the GUI's
+   FIFO: it takes only what fits until a reader drains it. Size 0 takes everything. */
+class DataBuffer
+{
+public:
+	DataBuffer(int numChannels, int size) : numChannels(numChannels), size(size), numSamples(0),
+		numCalls(0), numItems(0), numRead(0), numLost(0), lastTimestamp(0), checksum(0) {}
+
+	int addToBuffer(float* data, int64* timestamps, uint64* /* eventCodes */, int numItems_, int /* chunkSize */ = 1)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const int numWritten = size > 0 ? std::min(numItems_, size - numSamples) : numItems_;
+
+		numCalls++;
+
+		if (numWritten > 0)
+		{
+			//Timestamps count samples from 1, so any jump means rows never reached the buffer
+			numLost += timestamps[0] - lastTimestamp - 1;
+			lastTimestamp = timestamps[numWritten - 1];
+			numItems += numWritten;
+
+			if (size > 0)
+				numSamples += numWritten;
+
+			//Touch the data so the generator work cannot be optimised away
+			checksum += data[0] + data[(int64) numWritten * numChannels - 1];
+		}
+
+		return numWritten;
+	}
+
+	/* Removes up to maxItems rows, as the GUI's reader would; returns how many it took */
+	int readFromBuffer(int maxItems)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		const int numToRead = std::max(0, std::min(maxItems, numSamples));
+
+		numSamples -= numToRead;
+		numRead += numToRead;
+
+		return numToRead;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		numSamples = 0;
+		numCalls = numItems = numRead = numLost = lastTimestamp = 0;
+	}
+
+	int getNumSamples() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return numSamples;
+	}
+
+	/* Rows accepted so far; safe to call while a source is writing */
+	int64 getNumItems() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return numItems;
+	}
+
+	int numChannels;
+	int size;
+	int numSamples;
+
+	int64 numCalls;
+	int64 numItems;
+	int64 numRead;
+	int64 numLost;
+	int64 lastTimestamp;
+	double checksum;
+
+private:
+	mutable std::mutex mutex;
+};
+
+#endif
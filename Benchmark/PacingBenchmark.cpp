@@ -0,0 +1,365 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+	Real-time pacing accuracy benchmark.
+
+	Runs N sources for a fixed wall-clock duration, either on their own threads
+	(SourceSim::run) or on a SourceScheduler pool. For each packet it records
+	how late generation started relative to the packet's deadline. It then
+	reports:
+	  - the achieved sample rate relative to nominal (ppm)
+	  - wakeup latency percentiles (p50 / p99 / p99.9 / max)
+	  - the cumulative drift of the last packet behind its ideal time
+	  - the number of schedule re-anchors
+	  - process CPU time as a share of one core (pacing overhead plus generation)
+	  - t0 skew: spread of the instants the sources treat as sample 0, and the
+	    worst first-packet lateness against that epoch
+
+	Sources share one start epoch, as in SourceThread; --no-epoch lets each
+	source start its own timeline when its thread starts instead.
+
+	--packet-ms sets the packet duration (e.g. 1 for the low-latency mode);
+	by default sources keep DEFAULT_PACKET_SIZE samples.
+
+	--time-scale runs every source at that multiple of real time; the rate
+	error is then relative to the scaled rate. --type takes a list, cycled
+	over the sources (AP,LFP,AI for a mixed probe rig).
+
+	Usage: SourceSimPacingBenchmark [--sources 1,4,8,20] [--seconds 5] [--mode thread,scheduler]
+	                                [--workers 2] [--type AP,LFP,AI,APT] [--channels 384] [--packet-ms 1]
+	                                [--no-epoch] [--time-scale 10]
+*/
+
+#include "SourceSim.h"
+#include "SourceScheduler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cstring>
+#include <sstream>
+
+#define LATENCY_HISTOGRAM_US 100000
+
+/* Wakeup latencies in 1 us bins; the last bin collects everything beyond LATENCY_HISTOGRAM_US */
+struct LatencyHistogram
+{
+	LatencyHistogram() : bins(LATENCY_HISTOGRAM_US + 1, 0), numPackets(0), numEarly(0), maxNs(0) {}
+
+	void add(int64 latencyNs)
+	{
+		numPackets++;
+
+		if (latencyNs < 0)
+		{
+			numEarly++;
+			latencyNs = 0;
+		}
+
+		maxNs = jmax(maxNs, latencyNs);
+		bins[(size_t) jmin(latencyNs / 1000, (int64) LATENCY_HISTOGRAM_US)]++;
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (size_t i = 0; i < bins.size(); i++)
+			bins[i] += other.bins[i];
+
+		numPackets += other.numPackets;
+		numEarly += other.numEarly;
+		maxNs = jmax(maxNs, other.maxNs);
+	}
+
+	/* Upper edge of the bin holding the given quantile, in us */
+	double percentile(double quantile) const
+	{
+		const int64 target = (int64) std::ceil(quantile * (double) numPackets);
+		int64 seen = 0;
+
+		for (size_t i = 0; i < bins.size(); i++)
+		{
+			seen += bins[i];
+
+			if (seen >= target && seen > 0)
+				return (double) (i + 1);
+		}
+
+		return 0;
+	}
+
+	std::vector<int64> bins;
+	int64 numPackets;
+	int64 numEarly;
+	int64 maxNs;
+};
+
+/* Per-source pacing results, written only by the thread generating that source's packets */
+struct PacingRecord
+{
+	PacingRecord() : source(nullptr), firstPacket(true), finalLagNs(0) {}
+
+	LatencyHistogram latency;
+	SourceSim* source;
+
+	bool firstPacket;
+	steady_clock::time_point nominalStart;
+	steady_clock::time_point lastCompletion;
+	int64 finalLagNs;
+};
+
+/* Wraps a generator to time each packet against its deadline */
+template <class Generator>
+class PacedSource : public Generator, public PacingRecord
+{
+public:
+
+	PacedSource(int numChannels) : Generator(numChannels) { source = this; }
+
+	void generateDataPacket() override
+	{
+		const steady_clock::time_point deadline = this->getNextDeadline();
+
+		if (firstPacket)
+		{
+			nominalStart = this->startTime;
+			firstPacket = false;
+		}
+
+		latency.add(duration_cast<nanoseconds>(steady_clock::now() - deadline).count());
+
+		Generator::generateDataPacket();
+
+		//How far the packet just produced trails the ideal, never re-anchored timeline
+		const steady_clock::time_point ideal = nominalStart +
+			duration_cast<steady_clock::duration>(nanoseconds(this->timebase.getTick(this->numSamples)));
+
+		lastCompletion = steady_clock::now();
+		finalLagNs = duration_cast<nanoseconds>(lastCompletion - ideal).count();
+	}
+};
+
+template <class Generator>
+static SourceSim* createPacedSource(int numChannels, std::vector<PacingRecord*>& records)
+{
+	PacedSource<Generator>* source = new PacedSource<Generator>(numChannels);
+	records.push_back(source);
+	return source;
+}
+
+static SourceSim* createSource(const std::string& type, int numChannels, std::vector<PacingRecord*>& records)
+{
+	if (type == "AP")
+		return createPacedSource<NPX_AP_BAND>(numChannels, records);
+	else if (type == "LFP")
+		return createPacedSource<NPX_LFP_BAND>(numChannels, records);
+	else if (type == "AI")
+		return createPacedSource<NIDAQ>(numChannels, records);
+	else if (type == "APT")
+		return createPacedSource<APTrain>(numChannels, records);
+
+	return nullptr;
+}
+
+static std::vector<std::string> splitList(const char* text)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(text);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+
+	return items;
+}
+
+static void runCase(const std::string& mode, int numSources, double seconds, int numWorkers,
+	const std::vector<std::string>& types, int numChannels, float packetMs, bool sharedEpoch, double timeScale)
+{
+
+	OwnedArray<SourceSim> sources;
+	OwnedArray<DataBuffer> buffers;
+	std::vector<PacingRecord*> records;
+
+	for (int i = 0; i < numSources; i++)
+	{
+		const std::string& type = types[i % types.size()];
+		SourceSim* source = createSource(type, numChannels, records);
+
+		if (source == nullptr)
+		{
+			std::cerr << "Unknown source type " << type << std::endl;
+			return;
+		}
+
+		if (packetMs > 0)
+			source->setPacketDuration(packetMs);
+
+		source->setTimeScale(timeScale);
+
+		sources.add(source);
+		buffers.add(new DataBuffer(numChannels, 0));
+		source->buffer = buffers.getLast();
+		source->seed = i + 1;
+	}
+
+	ScopedPointer<SourceScheduler> scheduler;
+
+	const std::clock_t cpuStart = std::clock();
+
+	if (sharedEpoch)
+	{
+		const steady_clock::time_point epoch = steady_clock::now() + milliseconds(50);
+
+		for (auto source : sources)
+			source->epoch = epoch;
+	}
+
+	if (mode == "scheduler")
+	{
+		Array<SourceSim*> scheduled;
+
+		for (auto source : sources)
+			scheduled.add(source);
+
+		scheduler = new SourceScheduler(numWorkers, 0);
+		scheduler->start(scheduled);
+	}
+	else
+	{
+		for (auto source : sources)
+			source->startThread();
+	}
+
+	std::this_thread::sleep_for(duration<double>(seconds));
+
+	if (scheduler != nullptr)
+	{
+		scheduler->stop();
+	}
+	else
+	{
+		for (auto source : sources)
+			source->stopThread(-1);
+	}
+
+	const double cpuPercent = 100.0 * (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC / seconds;
+
+	//Merge every source's packets; rate and drift are averaged / maximised across sources
+	LatencyHistogram latency;
+	double rateErrorPpm = 0;
+	double maxLagMs = 0;
+	int64 resyncs = 0;
+	steady_clock::time_point firstStart = records[0]->nominalStart;
+	steady_clock::time_point lastStart = firstStart;
+	int64 maxStartLatenessNs = 0;
+
+	for (auto record : records)
+	{
+		firstStart = jmin(firstStart, record->nominalStart);
+		lastStart = jmax(lastStart, record->nominalStart);
+		maxStartLatenessNs = jmax(maxStartLatenessNs, record->source->stats.getSnapshot().startLatenessNs);
+
+		latency.merge(record->latency);
+		resyncs += record->source->numDeadlineResyncs;
+		maxLagMs = jmax(maxLagMs, (double) record->finalLagNs * 1e-6);
+
+		const double elapsed = duration<double>(record->lastCompletion - record->nominalStart).count();
+
+		if (elapsed > 0)
+			rateErrorPpm += ((double) record->source->numSamples / elapsed / (record->source->sampleRate * timeScale) - 1.0) * 1e6 / (double) records.size();
+	}
+
+	std::printf("%-9s %4d %10.1f %8.0f %8.0f %8.0f %9.0f %9.3f %7lld %6.1f %6.1f %8.1f %8.1f\n",
+		mode.c_str(), numSources, rateErrorPpm,
+		latency.percentile(0.5), latency.percentile(0.99), latency.percentile(0.999),
+		(double) latency.maxNs * 1e-3, maxLagMs, (long long) resyncs,
+		latency.numPackets > 0 ? 100.0 * (double) latency.numEarly / (double) latency.numPackets : 0.0,
+		cpuPercent,
+		(double) duration_cast<nanoseconds>(lastStart - firstStart).count() * 1e-3,
+		(double) maxStartLatenessNs * 1e-3);
+
+}
+
+int main(int argc, char** argv)
+{
+
+	std::vector<int> sourceCounts = { 1, 4, 8, 20 };
+	std::vector<std::string> modes = { "thread", "scheduler" };
+	std::vector<std::string> types = { "AP" };
+	double seconds = 5.0;
+	int numWorkers = 2;
+	int numChannels = 384;
+	float packetMs = 0;
+	bool sharedEpoch = true;
+	double timeScale = 1.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--sources") && hasValue)
+		{
+			sourceCounts.clear();
+			for (auto& item : splitList(argv[++i]))
+				sourceCounts.push_back(jlimit(1, 64, std::atoi(item.c_str())));
+		}
+		else if (!std::strcmp(argv[i], "--seconds") && hasValue)
+			seconds = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--mode") && hasValue)
+			modes = splitList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--workers") && hasValue)
+			numWorkers = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--type") && hasValue)
+			types = splitList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--channels") && hasValue)
+			numChannels = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--packet-ms") && hasValue)
+			packetMs = (float) std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--no-epoch"))
+			sharedEpoch = false;
+		else if (!std::strcmp(argv[i], "--time-scale") && hasValue)
+			timeScale = jlimit(0.01, 100.0, std::atof(argv[++i]));
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--sources 1,4,8,20] [--seconds 5] [--mode thread,scheduler]"
+				" [--workers 2] [--type AP,LFP,AI,APT] [--channels 384] [--packet-ms 1] [--no-epoch] [--time-scale 10]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (types.empty())
+		types.push_back("AP");
+
+	std::printf("%-9s %4s %10s %8s %8s %8s %9s %9s %7s %6s %6s %8s %8s\n",
+		"mode", "srcs", "rate ppm", "p50 us", "p99 us", "p99.9 us", "max us", "drift ms", "resyncs", "early%", "cpu%",
+		"t0 skew", "start us");
+
+	for (auto& mode : modes)
+		for (int numSources : sourceCounts)
+			runCase(mode, numSources, seconds, numWorkers, types, numChannels, packetMs, sharedEpoch, timeScale);
+
+	return 0;
+
+}
@@ -0,0 +1,356 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+	Headless long-session soak test.
+
+	Each source generates a window at sample 0. It then generates a second
+	window after SourceSim::seek() to the end of a simulated session (72 h
+	by default). Nothing is paced, and no sample in between is generated.
+	Both windows are checked:
+	  - timestamps are consecutive and continue from the seek position
+	  - TTL levels match the exact schedule floor(n * 2f / sampleRate) mod 2
+	  - the sine matches a double-precision reference computed from the exact
+	    phase (n * f mod sampleRate); APT repeats the same shape after every edge
+	  - every sample is finite, and the background noise RMS at the end is
+	    within SOAK_RMS_TOLERANCE of the start
+
+	Exits with 1 if any check fails.
+
+	Usage: SourceSimSoakTest [--sources AP,LFP,WB,AI,APT] [--hours 72] [--seconds 2]
+	                         [--channels 384] [--clock 14] [--units 0]
+*/
+
+#include "SourceSim.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+/* Largest sine error (in the generators' units, amplitude 1000) allowed after the seek */
+#define SOAK_WAVEFORM_TOLERANCE 1e-3
+
+/* Largest relative change of the background RMS between the two windows */
+#define SOAK_RMS_TOLERANCE 0.05
+
+/* Samples after a rising edge compared between APT action potentials (2 ms at 30 kHz) */
+#define SOAK_AP_SHAPE_SAMPLES 60
+
+struct SoakOptions
+{
+	std::vector<std::string> sources = { "AP", "LFP", "WB", "AI", "APT" };
+	double hours = 72.0;
+	double seconds = 2.0;
+	int channels = 384;
+	int clockFreq = 14;
+	int units = 0;
+};
+
+/* What one window of packets looked like */
+struct WindowResult
+{
+	WindowResult() : timestampsOk(true), clockOk(true), finite(true), numEdges(0),
+		maxWaveformError(0), residualRms(0), shapesMatch(true) {}
+
+	bool timestampsOk;
+	bool clockOk;
+	bool finite;
+	int64 numEdges;
+	double maxWaveformError;
+	double residualRms;
+
+	/* APT only: first action potential of the window, and whether every later one matched it */
+	std::vector<float> apShape;
+	bool shapesMatch;
+};
+
+static std::vector<std::string> splitList(const char* text)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(text);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+
+	return items;
+}
+
+/* Sine frequency of each generator (0 = no sine); the rates are whole numbers of Hz */
+static int getSineFrequency(const std::string& type)
+{
+	if (type == "AP" || type == "WB" || type == "LFP")
+		return 60;
+	else if (type == "AI")
+		return 10;
+
+	return 0;
+}
+
+/* Builds a source the way SourceThread::generateBuffers() does; clean sources carry only the sine */
+static SourceSim* createSource(const std::string& type, const SoakOptions& options, bool clean)
+{
+	SourceSim* source = nullptr;
+
+	if (type == "AP" || type == "WB")
+	{
+		NPX_AP_BAND* apBand = new NPX_AP_BAND(options.channels, type);
+		source = apBand;
+		source->seed = 1;
+
+		if (!clean)
+		{
+			apBand->setNumUnits(options.units);
+			apBand->setNoiseRms(10.0f);
+
+			if (type == "WB")
+				apBand->setColoredNoise(20.0f, 1.0f, 5.0f);
+		}
+	}
+	else if (type == "LFP")
+	{
+		source = new NPX_LFP_BAND(options.channels);
+		source->seed = 2;
+
+		if (!clean)
+		{
+			source->setNoiseRms(5.0f);
+			source->setColoredNoise(20.0f, 1.0f, 5.0f);
+		}
+	}
+	else if (type == "AI")
+	{
+		source = new NIDAQ(8);
+		source->seed = 3;
+	}
+	else if (type == "APT")
+	{
+		source = new APTrain(options.channels);
+		source->seed = 4;
+	}
+
+	if (source != nullptr)
+	{
+		source->setPacketDuration(10.0f);
+		source->updateClkFreq(options.clockFreq, 0);
+	}
+
+	return source;
+}
+
+static WindowResult runWindow(const std::string& type, const SoakOptions& options, int64 firstSample, bool clean)
+{
+
+	WindowResult result;
+	ScopedPointer<SourceSim> source = createSource(type, options, clean);
+
+	source->beginAcquisition();
+
+	if (firstSample > 0)
+		source->seek(firstSample);
+
+	const int64 rate = std::llround(source->sampleRate);
+	const int64 frequency = getSineFrequency(type);
+	const int64 clockFreq = options.clockFreq;
+	const int64 numRows = (int64) (options.seconds * (double) rate);
+	const double twoPi = 2.0 * 3.14159265358979323846;
+
+	int64 expectedTimestamp = firstSample + 1;
+	uint64 previousLevel = source->eventCode;
+	int64 shapeStart = -1;
+	std::vector<float> shape;
+	double sumOfSquares = 0;
+	int64 numValues = 0;
+
+	while (source->numSamples - firstSample < numRows)
+	{
+		source->generateDataPacket();
+
+		for (int i = 0; i < source->packetSize; i++)
+		{
+			const int64 timestamp = source->packet.timestamps[i];
+			const uint64 level = source->packet.eventCodes[i];
+			const float* row = source->packet.samples + (int64) i * source->numChannels;
+
+			//Sample n is delivered with timestamp n + 1
+			const int64 n = timestamp - 1;
+
+			if (timestamp != expectedTimestamp++)
+				result.timestampsOk = false;
+
+			//Edges sit at ceil(k * rate / 2f), so floor(n * 2f / rate) of them have passed by sample n
+			if (level != (uint64) ((n * 2 * clockFreq / rate) & 1))
+				result.clockOk = false;
+
+			if (level != previousLevel)
+			{
+				result.numEdges++;
+
+				if (level != 0)
+					shapeStart = n;
+			}
+
+			previousLevel = level;
+
+			//Exact phase in integers; only the final sine is floating point
+			const double reference = frequency > 0 ?
+				1000.0 * std::sin(twoPi * (double) ((n * frequency) % rate) / (double) rate) : 0.0;
+
+			for (int c = 0; c < source->numChannels; c++)
+			{
+				const double expected = (type == "LFP" && (c % 2) != 0) ? -reference : reference;
+				const double residual = (double) row[c] - expected;
+
+				if (!std::isfinite(row[c]))
+					result.finite = false;
+
+				if (clean && frequency > 0)
+					result.maxWaveformError = jmax(result.maxWaveformError, std::abs(residual));
+
+				sumOfSquares += residual * residual;
+				numValues++;
+			}
+
+			//APT: collect the samples following each rising edge and compare them with the first
+			if (shapeStart >= 0 && n - shapeStart < SOAK_AP_SHAPE_SAMPLES)
+			{
+				shape.push_back(row[0]);
+
+				if ((int) shape.size() == SOAK_AP_SHAPE_SAMPLES)
+				{
+					if (result.apShape.empty())
+						result.apShape = shape;
+					else if (shape != result.apShape)
+						result.shapesMatch = false;
+
+					shape.clear();
+					shapeStart = -1;
+				}
+			}
+		}
+	}
+
+	source->endAcquisition();
+
+	result.residualRms = numValues > 0 ? std::sqrt(sumOfSquares / (double) numValues) : 0.0;
+	return result;
+
+}
+
+static bool runSource(const std::string& type, const SoakOptions& options)
+{
+
+	ScopedPointer<SourceSim> probe = createSource(type, options, true);
+
+	if (probe == nullptr)
+	{
+		std::cerr << "Unknown source type " << type << std::endl;
+		return false;
+	}
+
+	const int64 endSample = (int64) std::llround(options.hours * 3600.0 * probe->sampleRate);
+
+	const WindowResult cleanStart = runWindow(type, options, 0, true);
+	const WindowResult cleanEnd = runWindow(type, options, endSample, true);
+	const WindowResult fullStart = runWindow(type, options, 0, false);
+	const WindowResult fullEnd = runWindow(type, options, endSample, false);
+
+	const WindowResult* windows[] = { &cleanStart, &cleanEnd, &fullStart, &fullEnd };
+
+	bool timestampsOk = true;
+	bool clockOk = true;
+	bool finite = true;
+
+	for (auto window : windows)
+	{
+		timestampsOk = timestampsOk && window->timestampsOk;
+		clockOk = clockOk && window->clockOk && window->numEdges > 0;
+		finite = finite && window->finite;
+	}
+
+	const bool waveformOk = cleanEnd.maxWaveformError <= SOAK_WAVEFORM_TOLERANCE;
+	const bool rmsOk = fullStart.residualRms == 0.0 ||
+		std::abs(fullEnd.residualRms / fullStart.residualRms - 1.0) <= SOAK_RMS_TOLERANCE;
+
+	//APT has no sine; its action potentials must look the same on day three as on day one
+	const bool shapesOk = type != "APT" ||
+		(!cleanStart.apShape.empty() && cleanEnd.apShape == cleanStart.apShape && cleanStart.shapesMatch && cleanEnd.shapesMatch);
+
+	const bool passed = timestampsOk && clockOk && finite && waveformOk && rmsOk && shapesOk;
+
+	std::printf("%-4s %7.1f %14lld %6s %6s %7lld %10.6f %10.6f %9.3f %9.3f %6s %6s\n",
+		type.c_str(), options.hours, (long long) endSample,
+		timestampsOk ? "ok" : "FAIL", clockOk ? "ok" : "FAIL",
+		(long long) cleanEnd.numEdges,
+		cleanStart.maxWaveformError, cleanEnd.maxWaveformError,
+		fullStart.residualRms, fullEnd.residualRms,
+		type == "APT" ? (shapesOk ? "ok" : "FAIL") : "-",
+		passed ? "PASS" : "FAIL");
+
+	return passed;
+
+}
+
+int main(int argc, char** argv)
+{
+
+	SoakOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (!std::strcmp(argv[i], "--sources") && hasValue)
+			options.sources = splitList(argv[++i]);
+		else if (!std::strcmp(argv[i], "--hours") && hasValue)
+			options.hours = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--seconds") && hasValue)
+			options.seconds = std::atof(argv[++i]);
+		else if (!std::strcmp(argv[i], "--channels") && hasValue)
+			options.channels = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "--clock") && hasValue)
+			options.clockFreq = jmax(1, std::atoi(argv[++i]));
+		else if (!std::strcmp(argv[i], "--units") && hasValue)
+			options.units = std::atoi(argv[++i]);
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--sources AP,LFP,WB,AI,APT] [--hours 72] [--seconds 2]"
+				" [--channels 384] [--clock 14] [--units 0]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::printf("%-4s %7s %14s %6s %6s %7s %10s %10s %9s %9s %6s %6s\n",
+		"src", "hours", "seek sample", "stamps", "ttl", "edges", "sine err 0", "sine err T", "rms 0", "rms T", "shape", "result");
+
+	bool passed = true;
+
+	for (auto& type : options.sources)
+		passed = runSource(type, options) && passed;
+
+	return passed ? 0 : 1;
+
+}
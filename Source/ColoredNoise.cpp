@@ -0,0 +1,166 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ColoredNoise.h"
+
+#include <cmath>
+
+ColoredNoise::ColoredNoise(int numChannels_, float sampleRate, float rms, float alpha, float correlationLength, int64 seed)
+	: numChannels(numChannels_), rng((uint64) seed, RNG_STREAM_COLORED_NOISE)
+{
+
+	const double pi = 3.14159265358979323846;
+
+	alpha = jlimit(0.0f, 2.0f, alpha);
+	correlationLength = jmax(0.0f, correlationLength);
+
+	//Spatial kernel: Gaussian over +/- 3 correlation lengths, sum of squares = 1
+	const int kernelRadius = (int) std::ceil(3.0f * correlationLength);
+	std::vector<double> kernel(2 * kernelRadius + 1);
+	double sumOfSquares = 0;
+
+	for (int k = -kernelRadius; k <= kernelRadius; k++)
+	{
+		const double weight = kernelRadius > 0 ? std::exp(-0.5 * k * k / (correlationLength * correlationLength)) : 1.0;
+		kernel[k + kernelRadius] = weight;
+		sumOfSquares += weight * weight;
+	}
+
+	//Smooth a white pool once (cyclically), so every window of it is already spatially correlated
+	const int poolSize = 1 << COLORED_NOISE_POOL_BITS;
+	std::vector<float> white(poolSize);
+	Philox((uint64) seed, RNG_STREAM_COLORED_NOISE_POOL).fillGaussian(white.data(), poolSize, 0);
+
+	pool.resize(poolSize + numChannels);
+
+	for (int i = 0; i < poolSize; i++)
+	{
+		double sum = 0;
+
+		for (int k = -kernelRadius; k <= kernelRadius; k++)
+			sum += kernel[k + kernelRadius] * white[(i + k) & (poolSize - 1)];
+
+		pool[i] = (float) (sum / std::sqrt(sumOfSquares));
+	}
+
+	std::copy(pool.begin(), pool.begin() + numChannels, pool.begin() + poolSize);
+
+	//Pole/zero pairs from COLORED_NOISE_MIN_FREQ up to Nyquist (matched-z)
+	const double ratio = std::pow(10.0, 1.0 / COLORED_NOISE_SECTIONS_PER_DECADE);
+	const double nyquist = sampleRate / 2.0;
+
+	for (double f = COLORED_NOISE_MIN_FREQ; f < nyquist; f *= ratio)
+	{
+		poles.push_back((float) std::exp(-2.0 * pi * f / sampleRate));
+		zeros.push_back((float) std::exp(-2.0 * pi * f * std::pow(ratio, alpha / 2.0) / sampleRate));
+	}
+
+	numSections = (int) poles.size();
+	state.assign((numSections + 1) * numChannels, 0.0f);
+
+	//Unit-variance white input gives output variance = energy of the cascade's impulse response
+	const int impulseLength = (int) (20.0 * sampleRate / (2.0 * pi * COLORED_NOISE_MIN_FREQ));
+	std::vector<double> previous(numSections + 1, 0.0);
+	double energy = 0;
+
+	for (int n = 0; n < impulseLength; n++)
+	{
+		double value = (n == 0) ? 1.0 : 0.0;
+
+		for (int s = 0; s < numSections; s++)
+		{
+			const double out = value - zeros[s] * previous[s] + poles[s] * previous[s + 1];
+			previous[s] = value;
+			value = out;
+		}
+
+		previous[numSections] = value;
+		energy += value * value;
+	}
+
+	gain = rms / (float) std::sqrt(energy);
+
+	offsets.resize(COLORED_NOISE_BLOCK_ROWS);
+
+}
+
+ColoredNoise::~ColoredNoise()
+{
+}
+
+void ColoredNoise::addNoise(float* samples, int numRows, int64 firstRow)
+{
+
+	float x[COLORED_NOISE_TILE_CHANNELS];
+
+	for (int r0 = 0; r0 < numRows; r0 += COLORED_NOISE_BLOCK_ROWS)
+	{
+		const int blockRows = jmin(COLORED_NOISE_BLOCK_ROWS, numRows - r0);
+
+		//One pool window per row, chosen by the row's sample index so packets can split anywhere
+		for (int r = 0; r < blockRows; r++)
+		{
+			const uint64 row = (uint64) (firstRow + r0 + r);
+			uint32 words[4];
+			rng.generate(row >> 2, words);
+			offsets[r] = words[row & 3] & ((1u << COLORED_NOISE_POOL_BITS) - 1);
+		}
+
+		//Run the cascade tile by tile so each tile's state stays in L1 for the whole block
+		for (int c0 = 0; c0 < numChannels; c0 += COLORED_NOISE_TILE_CHANNELS)
+		{
+			const int n = jmin(COLORED_NOISE_TILE_CHANNELS, numChannels - c0);
+
+			for (int r = 0; r < blockRows; r++)
+			{
+				const float* input = &pool[offsets[r] + c0];
+				std::copy(input, input + n, x);
+
+				for (int s = 0; s < numSections; s++)
+				{
+					const float z = zeros[s];
+					const float p = poles[s];
+					float* previousInput = &state[s * numChannels + c0];
+					const float* previousOutput = &state[(s + 1) * numChannels + c0];
+
+					for (int c = 0; c < n; c++)
+					{
+						const float out = x[c] - z * previousInput[c] + p * previousOutput[c];
+						previousInput[c] = x[c];
+						x[c] = out;
+					}
+				}
+
+				float* last = &state[numSections * numChannels + c0];
+				float* row = samples + (int64) (r0 + r) * numChannels + c0;
+
+				for (int c = 0; c < n; c++)
+				{
+					last[c] = x[c];
+					row[c] += gain * x[c];
+				}
+			}
+		}
+	}
+
+}
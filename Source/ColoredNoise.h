@@ -0,0 +1,95 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __COLOREDNOISE_H__
+#define __COLOREDNOISE_H__
+
+#include <DataThreadHeaders.h>
+
+#include "Philox.h"
+
+#include <vector>
+
+#define COLORED_NOISE_MIN_FREQ 0.5
+#define COLORED_NOISE_SECTIONS_PER_DECADE 2
+#define COLORED_NOISE_POOL_BITS 18
+#define COLORED_NOISE_BLOCK_ROWS 64
+#define COLORED_NOISE_TILE_CHANNELS 256
+
+/**
+
+	Streaming 1/f^alpha noise with spatial correlation across channels.
+
+	Spatial correlation is built once. At construction a pool of 2^18 white
+	Gaussians is convolved with a Gaussian kernel along its length. Any
+	contiguous window of the pool is then white noise correlated across
+	neighbouring channels, as along a shank. Each sample row reads such a
+	window at a Philox-chosen offset.
+
+	Each channel is then passed through a cascade of first-order pole/zero
+	sections. The poles sit two per decade from 0.5 Hz to Nyquist, and each
+	zero sits alpha/2 of the way to the next pole, giving a PSD slope of
+	-alpha (0 <= alpha <= 2) over that range. A section's previous input is
+	the previous section's previous output, so the only state is one float
+	per section (plus one) per channel. The cascade runs over tiles of
+	channels so that this state stays in L1 across a block of rows.
+
+	Memory does not grow with run length, and packets can be any size.
+
+*/
+class ColoredNoise
+{
+public:
+
+	ColoredNoise(int numChannels, float sampleRate, float rms, float alpha, float correlationLength, int64 seed);
+	~ColoredNoise();
+
+	/** Adds colored noise to numRows interleaved rows whose first row has the given sample index */
+	void addNoise(float* samples, int numRows, int64 firstRow);
+
+private:
+
+	int numChannels;
+	int numSections;
+
+	/* Spatially correlated unit-variance white noise, padded by numChannels for wrap-free windows */
+	std::vector<float> pool;
+
+	/* Section coefficients (shared by all channels) */
+	std::vector<float> poles;
+	std::vector<float> zeros;
+
+	/* [k * numChannels + channel]: previous input of section k, i.e. previous output of section k - 1 */
+	std::vector<float> state;
+
+	/* Scales the cascade output to the requested RMS */
+	float gain;
+
+	/* Per-row window offsets into the pool for the current block */
+	std::vector<uint32> offsets;
+
+	Philox rng;
+
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Decimator.h"
+
+#include <cmath>
+
+Decimator::Decimator(int numChannels_, float inputSampleRate, int factor_, int maxInputRows)
+	: output(nullptr), quantizer(nullptr), outputStats(nullptr), backpressure(false), numChannels(numChannels_), factor(factor_), nextExpectedRow(0), numOutputSamples(0)
+{
+
+	const int numTaps = factor * DECIMATOR_TAPS_PER_PHASE;
+	const double cutoff = DECIMATOR_CUTOFF_HZ / inputSampleRate;
+	const double pi = 3.14159265358979323846;
+
+	std::vector<double> taps(numTaps);
+	double sum = 0;
+
+	for (int k = 0; k < numTaps; k++)
+	{
+		const double t = k - (numTaps - 1) / 2.0;
+		const double sinc = (t == 0) ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * t) / (pi * t);
+		const double window = 0.42 - 0.5 * std::cos(2.0 * pi * k / (numTaps - 1)) + 0.08 * std::cos(4.0 * pi * k / (numTaps - 1));
+
+		taps[k] = sinc * window;
+		sum += taps[k];
+	}
+
+	//Input row factor * q + r feeds output q + j through tap factor * j + (factor - 1 - r)
+	phaseTaps.resize(numTaps);
+
+	for (int r = 0; r < factor; r++)
+		for (int j = 0; j < DECIMATOR_TAPS_PER_PHASE; j++)
+			phaseTaps[r * DECIMATOR_TAPS_PER_PHASE + j] = (float) (taps[factor * j + factor - 1 - r] / sum);
+
+	accumulators.assign(DECIMATOR_TAPS_PER_PHASE * numChannels, 0.0f);
+
+	packet.configure(numChannels, maxInputRows / factor + 1);
+
+}
+
+Decimator::~Decimator()
+{
+}
+
+void Decimator::reset(int64 inputRow)
+{
+	std::fill(accumulators.begin(), accumulators.end(), 0.0f);
+	nextExpectedRow = inputRow;
+	numOutputSamples = inputRow / factor;
+}
+
+void Decimator::accumulateRow(const float* input, int phase, int64 q)
+{
+	const float* h = &phaseTaps[phase * DECIMATOR_TAPS_PER_PHASE];
+
+	for (int j = 0; j < DECIMATOR_TAPS_PER_PHASE; j++)
+	{
+		float* acc = &accumulators[((q + j) % DECIMATOR_TAPS_PER_PHASE) * numChannels];
+		const float tap = h[j];
+
+		for (int c = 0; c < numChannels; c++)
+			acc[c] += tap * input[c];
+	}
+}
+
+void Decimator::accumulateBlock(const float* block, int64 q)
+{
+	const int fullTiles = numChannels / DECIMATOR_TILE_CHANNELS * DECIMATOR_TILE_CHANNELS;
+
+	for (int j0 = 0; j0 < DECIMATOR_TAPS_PER_PHASE; j0 += DECIMATOR_TILE_OUTPUTS)
+	{
+		float* acc[DECIMATOR_TILE_OUTPUTS];
+
+		for (int j = 0; j < DECIMATOR_TILE_OUTPUTS; j++)
+			acc[j] = &accumulators[((q + j0 + j) % DECIMATOR_TAPS_PER_PHASE) * numChannels];
+
+		for (int c0 = 0; c0 < fullTiles; c0 += DECIMATOR_TILE_CHANNELS)
+		{
+			float sums[DECIMATOR_TILE_OUTPUTS][DECIMATOR_TILE_CHANNELS];
+
+			for (int j = 0; j < DECIMATOR_TILE_OUTPUTS; j++)
+				for (int c = 0; c < DECIMATOR_TILE_CHANNELS; c++)
+					sums[j][c] = acc[j][c0 + c];
+
+			for (int r = 0; r < factor; r++)
+			{
+				const float* x = block + (int64) r * numChannels + c0;
+				const float* h = &phaseTaps[r * DECIMATOR_TAPS_PER_PHASE + j0];
+
+				for (int j = 0; j < DECIMATOR_TILE_OUTPUTS; j++)
+					for (int c = 0; c < DECIMATOR_TILE_CHANNELS; c++)
+						sums[j][c] += h[j] * x[c];
+			}
+
+			for (int j = 0; j < DECIMATOR_TILE_OUTPUTS; j++)
+				for (int c = 0; c < DECIMATOR_TILE_CHANNELS; c++)
+					acc[j][c0 + c] = sums[j][c];
+		}
+
+		//Channels past the last whole tile
+		for (int r = 0; r < factor; r++)
+		{
+			const float* x = block + (int64) r * numChannels;
+			const float* h = &phaseTaps[r * DECIMATOR_TAPS_PER_PHASE + j0];
+
+			for (int j = 0; j < DECIMATOR_TILE_OUTPUTS; j++)
+				for (int c = fullTiles; c < numChannels; c++)
+					acc[j][c] += h[j] * x[c];
+		}
+	}
+}
+
+void Decimator::process(const float* samples, const uint64* eventCodes, int numRows, int64 firstRow)
+{
+
+	if (firstRow != nextExpectedRow)
+		reset(firstRow);
+
+	int numOutputRows = 0;
+
+	for (int i = 0; i < numRows; )
+	{
+		const int64 row = firstRow + i;
+		const int64 q = row / factor;
+		int r = (int) (row % factor);
+
+		const float* input = samples + (int64) i * numChannels;
+
+		//Whole blocks take the tiled path; rows split across packets are accumulated one at a time
+		if (r == 0 && i + factor <= numRows)
+		{
+			accumulateBlock(input, q);
+			i += factor;
+			r = factor - 1;
+		}
+		else
+		{
+			accumulateRow(input, r, q);
+			i++;
+		}
+
+		//The last row of each block completes output q; hand it over and recycle its accumulator
+		if (r == factor - 1)
+		{
+			float* acc = &accumulators[(q % DECIMATOR_TAPS_PER_PHASE) * numChannels];
+
+			std::copy(acc, acc + numChannels, packet.samples + (int64) numOutputRows * numChannels);
+			std::fill(acc, acc + numChannels, 0.0f);
+
+			numOutputSamples++;
+			packet.timestamps[numOutputRows] = numOutputSamples;
+			packet.eventCodes[numOutputRows] = eventCodes[i - 1];
+			numOutputRows++;
+		}
+	}
+
+	nextExpectedRow = firstRow + numRows;
+
+	if (quantizer != nullptr)
+		quantizer->process(packet.samples, numOutputRows * numChannels);
+
+	if (numOutputRows > 0 && output != nullptr)
+	{
+		int64 blockedNs = 0;
+		const int numWritten = packet.writeTo(output, numOutputRows, numChannels, backpressure, blockedNs);
+
+		if (outputStats != nullptr)
+			outputStats->addBufferWrite(numOutputRows, numWritten, output->getNumSamples(), blockedNs);
+	}
+
+}
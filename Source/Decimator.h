@@ -0,0 +1,113 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __DECIMATOR_H__
+#define __DECIMATOR_H__
+
+#include <DataThreadHeaders.h>
+
+#include "PacketArena.h"
+#include "Quantizer.h"
+#include "SourceStats.h"
+
+#include <vector>
+
+#define DECIMATOR_TAPS_PER_PHASE 16
+#define DECIMATOR_CUTOFF_HZ 500.0
+
+/* Register tile for whole input blocks: pending outputs x channels kept in locals across the block */
+#define DECIMATOR_TILE_OUTPUTS 4
+#define DECIMATOR_TILE_CHANNELS 8
+
+/**
+
+	Streaming polyphase FIR decimator for interleaved multichannel packets.
+
+	The low-pass is a Blackman-windowed sinc of factor * DECIMATOR_TAPS_PER_PHASE
+	taps with unity DC gain. Each input row is accumulated straight into the
+	DECIMATOR_TAPS_PER_PHASE output rows it contributes to, using only the taps
+	of its phase. An output row is emitted as soon as its last input arrives.
+	No input history is kept and nothing is copied between packets.
+	Whole blocks of factor input rows are accumulated tile by tile, so each
+	partial sum is loaded and stored once per block rather than once per row.
+
+	Output row m is produced from input rows up to factor * (m + 1) - 1, so
+	after N input samples exactly N / factor output samples have been written,
+	however the input is split into packets.
+
+*/
+class Decimator
+{
+public:
+
+	Decimator(int numChannels, float inputSampleRate, int factor, int maxInputRows);
+	~Decimator();
+
+	/** Consumes numRows input rows starting at firstRow and writes completed output rows to the output buffer */
+	void process(const float* samples, const uint64* eventCodes, int numRows, int64 firstRow);
+
+	/** Clears the filter state so the next output row is built from inputRow onwards */
+	void reset(int64 inputRow);
+
+	/** Where decimated rows are written */
+	DataBuffer* output;
+
+	/** Applied to decimated rows before they are written (optional) */
+	const Quantizer* quantizer;
+
+	/** Receives overflow and fill counters for writes to output (optional) */
+	SourceStats* outputStats;
+
+	/** Wait for room in output instead of dropping rows (unpaced mode) */
+	bool backpressure;
+
+	/** Number of output rows written since the last reset */
+	int64 getNumOutputSamples() const { return numOutputSamples; }
+
+private:
+
+	int numChannels;
+	int factor;
+
+	/* Taps regrouped by input phase: [phase * DECIMATOR_TAPS_PER_PHASE + outputOffset] */
+	std::vector<float> phaseTaps;
+
+	/* Partial sums for the DECIMATOR_TAPS_PER_PHASE pending output rows, indexed by output row modulo that count */
+	std::vector<float> accumulators;
+
+	int64 nextExpectedRow;
+	int64 numOutputSamples;
+
+	/* Accumulates one input row of the given phase into the pending outputs q .. q + DECIMATOR_TAPS_PER_PHASE - 1 */
+	void accumulateRow(const float* input, int phase, int64 q);
+
+	/* Accumulates the factor input rows of block q (phases 0 .. factor - 1) */
+	void accumulateBlock(const float* block, int64 q);
+
+	PacketArena packet;
+
+	JUCE_DECLARE_NON_COPYABLE(Decimator);
+
+};
+
+#endif
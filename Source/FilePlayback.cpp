@@ -0,0 +1,198 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FilePlayback.h"
+
+FilePlayback::FilePlayback(File file_, int nChannels, float sampleRate, float bitVolts_)
+	: SourceSim("PB", nChannels, sampleRate), file(file_), data(nullptr), numFileSamples(0), bitVolts(bitVolts_)
+{
+
+	map = new MemoryMappedFile(file, MemoryMappedFile::readOnly);
+
+	if (map->getData() != nullptr && numChannels > 0)
+	{
+		data = (const int16*) map->getData();
+		numFileSamples = (int64) map->getSize() / ((int64) sizeof(int16) * numChannels);
+	}
+
+}
+
+FilePlayback::~FilePlayback()
+{
+}
+
+bool FilePlayback::isValid() const
+{
+	return data != nullptr && numFileSamples > 0;
+}
+
+bool FilePlayback::readRecordingInfo(const File& file, int& channels, float& sampleRate, float& bitVolts)
+{
+
+	//SpikeGLX: recording.bin + recording.meta
+	File meta = file.withFileExtension("meta");
+
+	if (meta.existsAsFile())
+	{
+		StringArray lines;
+		meta.readLines(lines);
+
+		StringPairArray values;
+
+		for (auto& line : lines)
+			values.set(line.upToFirstOccurrenceOf("=", false, false).trim().trimCharactersAtStart("~"),
+				line.fromFirstOccurrenceOf("=", false, false).trim());
+
+		if (values.containsKey("nSavedChans"))
+			channels = values["nSavedChans"].getIntValue();
+
+		if (values.containsKey("imSampRate"))
+			sampleRate = values["imSampRate"].getFloatValue();
+		else if (values.containsKey("niSampRate"))
+			sampleRate = values["niSampRate"].getFloatValue();
+
+		//uV per bit = ADC range / max int / gain; without a range the caller's value is kept
+		const bool imec = values["typeThis"] != "nidq" && values.containsKey("imAiRangeMax");
+		const double rangeMax = (imec ? values["imAiRangeMax"] : values["niAiRangeMax"]).getDoubleValue();
+		double maxInt = (imec ? values["imMaxInt"] : values["niMaxInt"]).getDoubleValue();
+		double gain = 1.0;
+
+		if (imec)
+		{
+			//imroTbl = (probeType,nChan)(channel bank ref apGain lfGain hpFilter)... for NP 1.0-style probes;
+			//NP 2.0 (types 21, 24, 2013) entries carry no gain, which is fixed
+			const String imroTable = values["imroTbl"];
+			const int probeType = imroTable.fromFirstOccurrenceOf("(", false, false).upToFirstOccurrenceOf(",", false, false).getIntValue();
+			StringArray imro = StringArray::fromTokens(imroTable.fromFirstOccurrenceOf(")(", false, false)
+				.upToFirstOccurrenceOf(")", false, false), " ", "");
+
+			const bool perChannelGain = probeType != 21 && probeType != 24 && probeType != 2013 && imro.size() >= 5;
+
+			if (maxInt <= 0)
+				maxInt = perChannelGain ? SPIKEGLX_NP1_MAX_INT : SPIKEGLX_NP2_MAX_INT;
+
+			gain = perChannelGain ? imro[file.getFileName().contains(".lf.") ? 4 : 3].getDoubleValue() : SPIKEGLX_NP2_GAIN;
+		}
+		else
+		{
+			//Multiplexed (MN) and aux (MA) channels are amplified; XA inputs are direct
+			StringArray counts = StringArray::fromTokens(values["snsMnMaXaDw"], ",", "");
+
+			if (maxInt <= 0)
+				maxInt = SPIKEGLX_NI_MAX_INT;
+
+			if (counts.size() > 0 && counts[0].getIntValue() > 0)
+				gain = values["niMNGain"].getDoubleValue();
+			else if (counts.size() > 1 && counts[1].getIntValue() > 0)
+				gain = values["niMAGain"].getDoubleValue();
+		}
+
+		if (rangeMax > 0 && gain > 0)
+			bitVolts = (float) (rangeMax / maxInt / gain * 1e6);
+
+		return true;
+	}
+
+	//Kilosort: params.py in the same directory (no gain information; the caller's bit volts are kept)
+	File params = file.getSiblingFile("params.py");
+
+	if (params.existsAsFile())
+	{
+		StringArray lines;
+		params.readLines(lines);
+
+		for (auto& line : lines)
+		{
+			String key = line.upToFirstOccurrenceOf("=", false, false).trim();
+			String value = line.fromFirstOccurrenceOf("=", false, false).trim();
+
+			if (key == "n_channels_dat")
+				channels = value.getIntValue();
+			else if (key == "sample_rate")
+				sampleRate = value.getFloatValue();
+		}
+
+		return true;
+	}
+
+	//Open Ephys binary: <recording>/continuous/<stream>/continuous.dat + <recording>/structure.oebin
+	File streamDirectory = file.getParentDirectory();
+	File oebin = streamDirectory.getParentDirectory().getSiblingFile("structure.oebin");
+
+	if (oebin.existsAsFile())
+	{
+		var structure = JSON::parse(oebin);
+
+		if (Array<var>* streams = structure["continuous"].getArray())
+		{
+			for (auto& stream : *streams)
+			{
+				if (stream["folder_name"].toString().upToFirstOccurrenceOf("/", false, false) != streamDirectory.getFileName())
+					continue;
+
+				channels = stream["num_channels"];
+				sampleRate = stream["sample_rate"];
+
+				if (Array<var>* channelInfo = stream["channels"].getArray())
+					if (channelInfo->size() > 0)
+						bitVolts = (*channelInfo)[0]["bit_volts"];
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+
+}
+
+void FilePlayback::generateDataPacket()
+{
+
+	float* samples = packet.samples;
+	int64* timestamps = packet.timestamps;
+	uint64* eventCodes = packet.eventCodes;
+
+	//The read position follows the sample counter, wrapping at the end of the file
+	int64 position = numSamples % numFileSamples;
+
+	for (int i = 0; i < packetSize; i++)
+	{
+		advanceClock(numSamples);
+
+		//Convert one frame directly out of the mapped file
+		const int16* frame = data + position * numChannels;
+		float* row = samples + i * numChannels;
+
+		for (int j = 0; j < numChannels; j++)
+			row[j] = bitVolts * (float) frame[j];
+
+		if (++position == numFileSamples)
+			position = 0;
+
+		numSamples++;
+		timestamps[i] = numSamples;
+		eventCodes[i] = eventCode;
+	}
+
+}
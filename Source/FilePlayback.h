@@ -0,0 +1,82 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __FILEPLAYBACK_H__
+#define __FILEPLAYBACK_H__
+
+#include "SourceSim.h"
+
+#include <DataThreadHeaders.h>
+
+#define PLAYBACK_DEFAULT_CHANNELS 384
+#define PLAYBACK_DEFAULT_SAMPLE_RATE 30000.0f
+#define PLAYBACK_DEFAULT_BIT_VOLTS 0.195f
+
+/* SpikeGLX ADC defaults for .meta files that predate imMaxInt / niMaxInt */
+#define SPIKEGLX_NP1_MAX_INT 512
+#define SPIKEGLX_NP2_MAX_INT 8192
+#define SPIKEGLX_NP2_GAIN 80
+#define SPIKEGLX_NI_MAX_INT 32768
+
+/**
+
+	Replays a flat interleaved int16 recording (Kilosort .bin, SpikeGLX .bin,
+	Open Ephys binary continuous.dat) at its native sample rate.
+
+	The file is memory-mapped, and each packet converts its samples straight
+	from the mapping into the packet arena. Nothing is staged in an
+	intermediate buffer, and only the pages being played are resident.
+	Playback loops to the start of the file when it reaches the end.
+
+	@see SourceSim
+
+*/
+class FilePlayback : public SourceSim
+{
+public:
+
+	FilePlayback(File file, int nChannels, float sampleRate, float bitVolts);
+	~FilePlayback();
+
+	/** Fills in channel count, sample rate and bit volts from sidecar metadata next to the file, if any.
+		Bit volts come from .oebin channel info or the SpikeGLX ADC range and gain; params.py leaves them unchanged */
+	static bool readRecordingInfo(const File& file, int& channels, float& sampleRate, float& bitVolts);
+
+	/** Returns false if the file could not be mapped or holds less than one sample */
+	bool isValid() const;
+
+	void generateDataPacket() override;
+
+	File file;
+
+private:
+
+	ScopedPointer<MemoryMappedFile> map;
+
+	const int16* data;
+	int64 numFileSamples;
+	float bitVolts;
+
+};
+
+#endif
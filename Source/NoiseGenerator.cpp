@@ -0,0 +1,146 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "NoiseGenerator.h"
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define NOISE_USE_SSE 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define NOISE_TARGET_AVX2
+#else
+#define NOISE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+NoiseGenerator::NoiseGenerator(int numChannels_, float rms_, int64 seed, uint64 stream)
+	: numChannels(numChannels_), rms(rms_), rng((uint64) seed, stream)
+{
+	jassert(numChannels <= NOISE_POOL_PADDING);
+
+	//Build the shared pool up front rather than on the first packet
+	getPool();
+}
+
+NoiseGenerator::~NoiseGenerator()
+{
+}
+
+void NoiseGenerator::setRms(float rms_)
+{
+	rms = rms_;
+}
+
+const float* NoiseGenerator::getPool()
+{
+
+	struct Pool
+	{
+		Pool() : values(NOISE_POOL_SIZE + NOISE_POOL_PADDING)
+		{
+			Philox poolRng(0x5EED, RNG_STREAM_NOISE);
+			poolRng.fillGaussian(values.data(), NOISE_POOL_SIZE, 0);
+
+			//Repeat the start after the end so every window is contiguous
+			std::copy(values.begin(), values.begin() + NOISE_POOL_PADDING, values.begin() + NOISE_POOL_SIZE);
+		}
+
+		std::vector<float> values;
+	};
+
+	static const Pool pool;
+	return pool.values.data();
+
+}
+
+void NoiseGenerator::addNoise(float* samples, int numRows, int64 firstRow)
+{
+
+	if (rms <= 0.0f)
+		return;
+
+	const float* pool = getPool();
+	uint32 words[4];
+
+	for (int i = 0; i < numRows; i++)
+	{
+		//One Philox block holds the pool offsets of four consecutive rows
+		const int64 row = firstRow + i;
+
+		if (i == 0 || (row & 3) == 0)
+			rng.generate((uint64) row >> 2, words);
+
+		const uint32 offset = words[row & 3] & (NOISE_POOL_SIZE - 1);
+
+		addScaled(samples + (int64) i * numChannels, pool + offset, rms, numChannels);
+	}
+
+}
+
+#ifdef NOISE_USE_SSE
+
+NOISE_TARGET_AVX2 static void addScaledAVX2(float* dst, const float* src, float gain, int n)
+{
+	const __m256 g = _mm256_set1_ps(gain);
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(g, _mm256_loadu_ps(src + i))));
+
+	for (; i < n; i++)
+		dst[i] += gain * src[i];
+}
+
+static void addScaledSSE(float* dst, const float* src, float gain, int n)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	int i = 0;
+
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(g, _mm_loadu_ps(src + i))));
+
+	for (; i < n; i++)
+		dst[i] += gain * src[i];
+}
+
+#endif
+
+void NoiseGenerator::addScaled(float* dst, const float* src, float gain, int n)
+{
+
+#ifdef NOISE_USE_SSE
+	static const bool hasAVX2 = SystemStats::hasAVX2();
+
+	if (hasAVX2)
+		addScaledAVX2(dst, src, gain, n);
+	else
+		addScaledSSE(dst, src, gain, n);
+#else
+	for (int i = 0; i < n; i++)
+		dst[i] += gain * src[i];
+#endif
+
+}
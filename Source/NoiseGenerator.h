@@ -0,0 +1,79 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __NOISEGENERATOR_H__
+#define __NOISEGENERATOR_H__
+
+#include <DataThreadHeaders.h>
+
+#include "Philox.h"
+
+#define NOISE_POOL_BITS 20
+#define NOISE_POOL_SIZE (1 << NOISE_POOL_BITS)
+#define NOISE_POOL_PADDING 4096
+
+/**
+
+	Adds white Gaussian noise with a configurable RMS to an interleaved block.
+
+	Generating a fresh normal per channel-sample costs several ns, which is
+	too much for 384 channels x 30 kHz x many probes. Instead, one pool of
+	2^20 Philox normals is built once and shared by all sources. Each sample
+	row is a window of the pool at an offset drawn from this source's own
+	Philox stream, keyed by the row's sample index. The output is therefore
+	reproducible and does not depend on packet size or thread timing. The
+	inner loop is a single scaled add, with SSE and AVX2 kernels and a scalar
+	fallback.
+
+	Two rows share values only when their windows overlap (probability
+	numChannels / 2^20 per pair), and then at a shifted channel. Downstream
+	detectors and filters cannot see this.
+
+*/
+class NoiseGenerator
+{
+public:
+
+	NoiseGenerator(int numChannels, float rms, int64 seed, uint64 stream = RNG_STREAM_NOISE);
+	~NoiseGenerator();
+
+	/** Adds noise to numRows interleaved rows whose first row has the given sample index */
+	void addNoise(float* samples, int numRows, int64 firstRow);
+
+	void setRms(float rms);
+	float getRms() const { return rms; }
+
+	/** dst[i] += gain * src[i], using the widest instruction set available at run time */
+	static void addScaled(float* dst, const float* src, float gain, int n);
+
+private:
+
+	static const float* getPool();
+
+	int numChannels;
+	float rms;
+	Philox rng;
+
+};
+
+#endif
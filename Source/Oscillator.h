@@ -0,0 +1,104 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __OSCILLATOR_H__
+#define __OSCILLATOR_H__
+
+#include <DataThreadHeaders.h>
+
+#include <cmath>
+
+#define OSC_TABLE_BITS 12
+#define OSC_TABLE_SIZE (1 << OSC_TABLE_BITS)
+
+/**
+	Unit-amplitude sine oscillator built on a 64-bit phase accumulator.
+
+	One full cycle spans the whole uint64 range, so the phase wraps for free
+	and the phase after n samples is exactly n * increment (mod 2^64). The
+	only error source is the rounding of the increment itself (< 2^-64 cycles
+	per sample), which stays far below one table step even after days of samples.
+
+	Values are read from a shared 4096-point table with linear interpolation.
+
+*/
+class Oscillator
+{
+public:
+
+	Oscillator(double frequency, double sampleRate) : table(getTable()), phase(0)
+	{
+		setFrequency(frequency, sampleRate);
+	}
+
+	/** Sets the oscillator frequency in Hz for a given sample rate */
+	void setFrequency(double frequency, double sampleRate)
+	{
+		double cycles = frequency / sampleRate;
+		cycles -= std::floor(cycles);
+		increment = (uint64) std::ldexp(cycles, 64);
+	}
+
+	/** Moves the phase to the value it has after sampleIndex samples */
+	void setSampleIndex(int64 sampleIndex)
+	{
+		phase = (uint64) sampleIndex * increment;
+	}
+
+	/** Returns the current value and advances the phase by one sample */
+	inline float next()
+	{
+		const int index = (int) (phase >> (64 - OSC_TABLE_BITS));
+		const float frac = (float) ((phase >> (64 - OSC_TABLE_BITS - 24)) & 0xFFFFFF) * (1.0f / 16777216.0f);
+
+		phase += increment;
+
+		return table[index] + frac * (table[index + 1] - table[index]);
+	}
+
+private:
+
+	/* Shared sine table with one guard point for interpolation */
+	static const float* getTable()
+	{
+		struct SineTable
+		{
+			SineTable()
+			{
+				for (int i = 0; i <= OSC_TABLE_SIZE; i++)
+					values[i] = (float) std::sin(2.0 * 3.14159265358979323846 * (double) i / (double) OSC_TABLE_SIZE);
+			}
+			float values[OSC_TABLE_SIZE + 1];
+		};
+
+		static const SineTable table;
+		return table.values;
+	}
+
+	const float* table;
+	uint64 phase;
+	uint64 increment;
+
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PACKETARENA_H__
+#define __PACKETARENA_H__
+
+#include <DataThreadHeaders.h>
+
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+
+#define PACKET_ARENA_ALIGNMENT 64
+
+/* How long a writer under backpressure sleeps before checking the buffer again */
+#define BACKPRESSURE_POLL_MS 1
+
+/**
+	Preallocated storage for one data packet: interleaved samples
+	(packetSize x numChannels), plus one timestamp and one event code per sample.
+
+	All three arrays live in a single block and each starts on a cache line.
+	The block is only reallocated by configure() when the requested packet
+	no longer fits, so the generation loop itself never touches the heap.
+
+*/
+class PacketArena
+{
+public:
+
+	PacketArena() : samples(nullptr), timestamps(nullptr), eventCodes(nullptr),
+		block(nullptr), capacity(0), numAllocations(0) {}
+
+	~PacketArena()
+	{
+		std::free(block);
+	}
+
+	/** Sizes the arena for a packet; only allocates if the current block is too small */
+	void configure(int numChannels, int packetSize)
+	{
+		size_t sampleBytes = align((size_t) numChannels * packetSize * sizeof(float));
+		size_t timestampBytes = align((size_t) packetSize * sizeof(int64));
+		size_t eventCodeBytes = align((size_t) packetSize * sizeof(uint64));
+
+		size_t required = sampleBytes + timestampBytes + eventCodeBytes;
+
+		if (required > capacity)
+		{
+			std::free(block);
+			block = std::malloc(required + PACKET_ARENA_ALIGNMENT);
+			capacity = required;
+			numAllocations++;
+		}
+
+		char* base = (char*) align((size_t) block);
+
+		samples = (float*) base;
+		timestamps = (int64*) (base + sampleBytes);
+		eventCodes = (uint64*) (base + sampleBytes + timestampBytes);
+	}
+
+	/** Hands the first numRows rows to buffer and returns how many it took. With backpressure, rows
+		that do not fit are retried as the reader drains the buffer instead of being dropped, until
+		the calling thread is asked to exit; the time spent waiting is added to blockedNs */
+	int writeTo(DataBuffer* buffer, int numRows, int numChannels, bool backpressure, int64& blockedNs)
+	{
+		int numWritten = buffer->addToBuffer(samples, timestamps, eventCodes, numRows, 1);
+
+		if (!backpressure || numWritten >= numRows)
+			return numWritten;
+
+		const std::chrono::steady_clock::time_point blockedSince = std::chrono::steady_clock::now();
+
+		while (numWritten < numRows && !Thread::currentThreadShouldExit())
+		{
+			Thread::sleep(BACKPRESSURE_POLL_MS);
+
+			numWritten += buffer->addToBuffer(samples + (int64) numWritten * numChannels,
+				timestamps + numWritten, eventCodes + numWritten, numRows - numWritten, 1);
+		}
+
+		blockedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - blockedSince).count();
+
+		return numWritten;
+	}
+
+	/** Number of times the arena has hit the heap (debug check for the steady-state loop) */
+	int64 getNumAllocations() const { return numAllocations.load(); }
+
+	float* samples;
+	int64* timestamps;
+	uint64* eventCodes;
+
+private:
+
+	static size_t align(size_t value)
+	{
+		return (value + PACKET_ARENA_ALIGNMENT - 1) & ~((size_t) PACKET_ARENA_ALIGNMENT - 1);
+	}
+
+	void* block;
+	size_t capacity;
+	std::atomic<int64> numAllocations;
+
+	JUCE_DECLARE_NON_COPYABLE(PacketArena);
+
+};
+
+#endif
@@ -0,0 +1,276 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PHILOX_H__
+#define __PHILOX_H__
+
+#include <DataThreadHeaders.h>
+
+#include <cmath>
+#include <cstring>
+
+/* Independent random streams derived from one per-source seed */
+#define RNG_STREAM_CLOCK 1
+#define RNG_STREAM_UNITS 2
+#define RNG_STREAM_SPIKES 3
+#define RNG_STREAM_NOISE 4
+#define RNG_STREAM_COLORED_NOISE 5
+#define RNG_STREAM_COLORED_NOISE_POOL 6
+#define RNG_STREAM_RATE_SKEW 7
+
+#define PHILOX_BATCH_BLOCKS 64
+
+/**
+
+	Philox4x32-10 counter-based random number generator (Salmon et al., SC'11).
+
+	Every 128-bit counter maps to four random 32-bit words under a 64-bit key,
+	with no hidden state. Any block of the sequence can therefore be computed
+	directly from its index. Noise for different packets, channels or threads
+	can be generated in any order and still come out bit-identical between runs.
+
+	The object also keeps a running counter for sequential draws. Use its own
+	samplers (nextDouble, nextGaussian, nextGamma) rather than the <random>
+	distributions, whose algorithms differ between standard libraries.
+
+*/
+class Philox
+{
+public:
+
+	typedef uint32 result_type;
+
+	Philox(uint64 seed = 0, uint64 stream = 0)
+	{
+		this->seed(seed, stream);
+	}
+
+	/** Selects the key (seed) and the stream; restarts the running counter */
+	void seed(uint64 seed, uint64 stream)
+	{
+		key[0] = (uint32) seed;
+		key[1] = (uint32) (seed >> 32);
+		streamId = stream;
+		position = 0;
+		available = 0;
+	}
+
+	/** Computes the four words of block `index` in this stream */
+	inline void generate(uint64 index, uint32 out[4]) const
+	{
+		uint32 c0 = (uint32) index;
+		uint32 c1 = (uint32) (index >> 32);
+		uint32 c2 = (uint32) streamId;
+		uint32 c3 = (uint32) (streamId >> 32);
+		uint32 k0 = key[0];
+		uint32 k1 = key[1];
+
+		for (int round = 0; round < 10; round++)
+		{
+			const uint64 p0 = (uint64) 0xD2511F53u * c0;
+			const uint64 p1 = (uint64) 0xCD9E8D57u * c2;
+
+			const uint32 n0 = (uint32) (p1 >> 32) ^ c1 ^ k0;
+			const uint32 n2 = (uint32) (p0 >> 32) ^ c3 ^ k1;
+
+			c0 = n0;
+			c1 = (uint32) p1;
+			c2 = n2;
+			c3 = (uint32) p0;
+
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
+
+	/** Fills n standard normal values from the blocks starting at firstBlock (four values per block) */
+	void fillGaussian(float* out, int n, uint64 firstBlock) const
+	{
+		uint32 words[4 * PHILOX_BATCH_BLOCKS];
+
+		for (int start = 0; start < n; start += 4 * PHILOX_BATCH_BLOCKS)
+		{
+			const int count = jmin(n - start, 4 * PHILOX_BATCH_BLOCKS);
+			const int numBlocks = (count + 3) / 4;
+
+			//Blocks are independent, so this loop has no carried state
+			for (int b = 0; b < numBlocks; b++)
+				generate(firstBlock + start / 4 + b, &words[4 * b]);
+
+			//Box-Muller on word pairs (i, i + half), branch-free so the compiler can vectorize it
+			const int half = 2 * numBlocks;
+			float pairs[4 * PHILOX_BATCH_BLOCKS];
+
+			for (int i = 0; i < half; i++)
+			{
+				const float radius = fastSqrt(-2.0f * fastLog(toUnitInterval(words[i])));
+
+				//Angle 2x with x in (-pi/2, pi/2): sin 2x = 2 s c, cos 2x = 1 - 2 s^2
+				const float x = 3.14159265359f * (toUnitInterval(words[half + i]) - 0.5f);
+				const float x2 = x * x;
+				const float sine = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+				const float cosine = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600))))));
+
+				pairs[i] = radius * (1.0f - 2.0f * sine * sine);
+				pairs[half + i] = radius * 2.0f * sine * cosine;
+			}
+
+			for (int i = 0; i < count; i++)
+				out[start + i] = pairs[i];
+		}
+	}
+
+	/** Moves the running counter to a block index */
+	void setPosition(uint64 blockIndex)
+	{
+		position = blockIndex;
+		available = 0;
+	}
+
+	/** Next word of the running sequence (UniformRandomBitGenerator) */
+	result_type operator()()
+	{
+		if (available == 0)
+		{
+			generate(position++, buffered);
+			available = 4;
+		}
+
+		return buffered[4 - available--];
+	}
+
+	/** Uniform double in [0, 1) with 53 bits of resolution from the running sequence */
+	double nextDouble()
+	{
+		const uint64 hi = (*this)();
+		const uint64 lo = (*this)();
+		return (double) (((hi << 32) | lo) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/** Standard normal value from the next block of the running sequence, via the fillGaussian() Box-Muller path */
+	float nextGaussian()
+	{
+		float value;
+		fillGaussian(&value, 1, position++);
+		available = 0;
+		return value;
+	}
+
+	/** Gamma(shape, 1) value from the running sequence (Marsaglia-Tsang, 2000) */
+	double nextGamma(double shape)
+	{
+		//Below shape 1 the squeeze does not apply: draw at shape + 1 and scale by u^(1 / shape)
+		if (shape < 1.0)
+		{
+			const double u = nextDouble();
+			return nextGamma(shape + 1.0) * std::pow(u, 1.0 / shape);
+		}
+
+		const double d = shape - 1.0 / 3.0;
+		const double c = 1.0 / std::sqrt(9.0 * d);
+
+		while (true)
+		{
+			double x, v;
+
+			do
+			{
+				x = nextGaussian();
+				v = 1.0 + c * x;
+			}
+			while (v <= 0.0);
+
+			v = v * v * v;
+
+			const double u = nextDouble();
+
+			if (u < 1.0 - 0.0331 * x * x * x * x
+				|| std::log(u) < 0.5 * x * x + d * (1.0 - v + std::log(v)))
+				return d * v;
+		}
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+	/** Maps a word to the open interval (0, 1) */
+	static inline float toUnitInterval(uint32 word)
+	{
+		return ((float) (word >> 8) + 0.5f) * (1.0f / 16777216.0f);
+	}
+
+private:
+
+	/* Natural log for x in (0, 1]: exponent from the float bits, atanh series for the mantissa */
+	static inline float fastLog(float x)
+	{
+		uint32 bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+
+		const float exponent = (float) ((int) (bits >> 23) - 127);
+
+		bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+
+		float mantissa;
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+		const float t = (mantissa - 1.0f) / (mantissa + 1.0f);
+		const float t2 = t * t;
+
+		return 0.69314718056f * exponent
+			+ 2.0f * t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9 + t2 * (1.0f / 11))))));
+	}
+
+	/* Square root for x > 0 via the reciprocal square root and Newton steps (no errno path) */
+	static inline float fastSqrt(float x)
+	{
+		uint32 bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+
+		bits = 0x5F3759DFu - (bits >> 1);
+
+		float inverse;
+		std::memcpy(&inverse, &bits, sizeof(inverse));
+
+		inverse = inverse * (1.5f - 0.5f * x * inverse * inverse);
+		inverse = inverse * (1.5f - 0.5f * x * inverse * inverse);
+		inverse = inverse * (1.5f - 0.5f * x * inverse * inverse);
+
+		return x * inverse;
+	}
+
+	uint32 key[2];
+	uint64 streamId;
+
+	uint64 position;
+	uint32 buffered[4];
+	int available;
+
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROBEPROFILE_H__
+#define __PROBEPROFILE_H__
+
+#include <DataThreadHeaders.h>
+
+#define NUM_PROBE_PROFILES 3
+#define NUM_PROBE_GAINS 8
+
+/**
+
+	Describes the data one simulated probe produces.
+
+	A profile with lfpSampleRate > 0 has separate AP and LFP subprocessors
+	(Neuropixels 1.0). Otherwise it has a single wideband subprocessor that
+	carries both the spike band and the 1/f LFP background (Neuropixels 2.0
+	and denser probes).
+
+	Bit-volts follow the ADC: range / 2^bits / gain, in uV. Probes without
+	selectable gain ignore the gain index.
+
+*/
+struct ProbeProfile
+{
+	const char* name;
+
+	/* Default and maximum recorded channels, and the number of electrode sites they are chosen from */
+	int numChannels;
+	int maxChannels;
+	int numSites;
+
+	float apSampleRate;
+	float lfpSampleRate;
+
+	int adcBits;
+	float adcRangeUv;
+
+	/* Gain table (selectable probes) or a single fixed gain */
+	bool selectableGain;
+	float gains[NUM_PROBE_GAINS];
+
+	bool hasLfpBand() const { return lfpSampleRate > 0; }
+
+	float getBitVolts(int gainIndex) const
+	{
+		const float gain = selectableGain ? gains[jlimit(0, NUM_PROBE_GAINS - 1, gainIndex)] : gains[0];
+		return adcRangeUv / (float) (1 << adcBits) / gain;
+	}
+
+	static const ProbeProfile& get(int index)
+	{
+		static const ProbeProfile profiles[NUM_PROBE_PROFILES] = {
+			{ "NPX 1.0", 384, 384, 960, 30000.0f, 2500.0f, 10, 1.2e6f, true, { 50, 125, 250, 500, 1000, 1500, 2000, 3000 } },
+			{ "NPX 2.0", 384, 384, 1280, 30000.0f, 0.0f, 14, 1.24e6f, false, { 80 } },
+			{ "HD 1024", 1024, 2048, 4096, 30000.0f, 0.0f, 12, 1.24e6f, false, { 80 } }
+		};
+
+		return profiles[jlimit(0, NUM_PROBE_PROFILES - 1, index)];
+	}
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Quantizer.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define QUANTIZER_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+void Quantizer::setResolution(float bitVolts_, int bits)
+{
+	bits = jlimit(2, 16, bits);
+
+	bitVolts = jmax(0.0f, bitVolts_);
+	scale = bitVolts > 0 ? 1.0f / bitVolts : 0.0f;
+	minCount = -(1 << (bits - 1));
+	maxCount = (1 << (bits - 1)) - 1;
+}
+
+void Quantizer::process(float* samples, int n) const
+{
+
+	if (!isEnabled())
+		return;
+
+	int i = 0;
+
+#ifdef QUANTIZER_USE_SSE
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 lo = _mm_set1_ps((float) minCount);
+	const __m128 hi = _mm_set1_ps((float) maxCount);
+
+	for (; i + 8 <= n; i += 8)
+	{
+		//Clamp to the ADC range, round to nearest (MXCSR default) and pack to int16
+		const __m128 x0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(samples + i), s), lo), hi);
+		const __m128 x1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(samples + i + 4), s), lo), hi);
+		const __m128i counts = _mm_packs_epi32(_mm_cvtps_epi32(x0), _mm_cvtps_epi32(x1));
+
+		//Sign-extend back to int32 and store as float
+		_mm_storeu_ps(samples + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(counts, counts), 16)));
+		_mm_storeu_ps(samples + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(counts, counts), 16)));
+	}
+#endif
+
+	for (; i < n; i++)
+	{
+		const float count = std::nearbyint(samples[i] * scale);
+		samples[i] = jlimit((float) minCount, (float) maxCount, count);
+	}
+
+}
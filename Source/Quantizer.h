@@ -0,0 +1,69 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __QUANTIZER_H__
+#define __QUANTIZER_H__
+
+#include <DataThreadHeaders.h>
+
+/**
+
+	Converts samples to signed ADC counts in place.
+
+	Each value is divided by the LSB size (bitVolts), rounded to the nearest
+	integer and clamped to the range of a bits-wide ADC. The result is still
+	stored as a float, because DataBuffer only carries floats, but it holds
+	exactly the int16 value a real headstage would deliver. Downstream
+	processors recover volts through getBitVolts().
+
+	The x86 path goes through a saturating float -> int16 pack, eight samples
+	per iteration.
+
+*/
+class Quantizer
+{
+public:
+
+	Quantizer() : bitVolts(0), scale(0), minCount(0), maxCount(0) {}
+
+	/** Sets the LSB size (in sample units) and ADC resolution; bitVolts <= 0 disables quantization */
+	void setResolution(float bitVolts, int bits);
+
+	bool isEnabled() const { return bitVolts > 0; }
+
+	/** LSB size in sample units, 0 when disabled */
+	float getBitVolts() const { return bitVolts; }
+
+	/** Replaces n samples with their ADC counts */
+	void process(float* samples, int n) const;
+
+private:
+
+	float bitVolts;
+	float scale;
+	int minCount;
+	int maxCount;
+
+};
+
+#endif
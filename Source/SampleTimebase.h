@@ -0,0 +1,137 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SAMPLETIMEBASE_H__
+#define __SAMPLETIMEBASE_H__
+
+#include <DataThreadHeaders.h>
+
+#include <cmath>
+
+#if defined(_MSC_VER) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#endif
+
+/* Master simulation clock: 64-bit nanosecond ticks since the shared start epoch */
+#define SIM_TICKS_PER_SECOND 1000000000LL
+
+/* Sample rates are taken to the nearest mHz, rate skews to the nearest ppb, time scales to 1/1000 */
+#define SIM_RATE_DENOMINATOR 1000
+#define SIM_SKEW_DENOMINATOR 1000000000LL
+#define SIM_TIME_SCALE_DENOMINATOR 1000
+
+/**
+
+	Maps a source's sample index onto the master tick counter.
+
+	The nominal rate is held as a reduced fraction (30000/1, 2500/1, ...), so
+	sample n is acquired at floor(n * ticksPerSecond * den / num) ticks. A
+	rate skew in ppm scales that tick by 1e9 / (1e9 + ppb), and a time scale
+	(2 = twice real time) divides it, so the master clock itself can run
+	faster or slower than the wall clock. Every tick is
+	computed from n directly in 128-bit integer arithmetic, so nothing
+	accumulates. Sources with the same nominal rates and skew keep exact
+	sample-count ratios (AP sample 12k and LFP sample k share a tick) for as
+	long as the counters run.
+
+*/
+class SampleTimebase
+{
+public:
+
+	SampleTimebase() { setRate(1.0, 0.0); }
+
+	/** Nominal sample rate, the source clock's deviation from it (positive = fast) and the simulation speed */
+	void setRate(double samplesPerSecond, double skewPpm, double timeScale = 1.0)
+	{
+		uint64 rateNum = (uint64) jmax((int64) 1, (int64) std::llround(samplesPerSecond * SIM_RATE_DENOMINATOR));
+		uint64 rateDen = SIM_RATE_DENOMINATOR;
+		reduce(rateNum, rateDen);
+
+		//Ticks per sample = ticksPerSecond * rateDen / rateNum
+		tickNum = (uint64) SIM_TICKS_PER_SECOND * rateDen;
+		tickDen = rateNum;
+		reduce(tickNum, tickDen);
+
+		skewNum = (uint64) SIM_SKEW_DENOMINATOR;
+		skewDen = (uint64) (SIM_SKEW_DENOMINATOR + jmax((int64) -SIM_SKEW_DENOMINATOR / 2, (int64) std::llround(skewPpm * 1000.0)));
+		reduce(skewNum, skewDen);
+
+		scaleNum = SIM_TIME_SCALE_DENOMINATOR;
+		scaleDen = (uint64) jmax((int64) 1, (int64) std::llround(timeScale * SIM_TIME_SCALE_DENOMINATOR));
+		reduce(scaleNum, scaleDen);
+	}
+
+	/** Master tick at which the given sample is acquired */
+	int64 getTick(int64 sampleIndex) const
+	{
+		const uint64 nominal = mulDiv((uint64) sampleIndex, tickNum, tickDen);
+		const uint64 skewed = skewNum == skewDen ? nominal : mulDiv(nominal, skewNum, skewDen);
+		return (int64) (scaleNum == scaleDen ? skewed : mulDiv(skewed, scaleNum, scaleDen));
+	}
+
+	/** floor(a * b / c) without intermediate overflow; the result must fit in 64 bits */
+	static uint64 mulDiv(uint64 a, uint64 b, uint64 c)
+	{
+#if defined(__SIZEOF_INT128__)
+		return (uint64) ((unsigned __int128) a * b / c);
+#else
+		uint64 high;
+		const uint64 low = _umul128(a, b, &high);
+		uint64 remainder;
+		return _udiv128(high, low, c, &remainder);
+#endif
+	}
+
+	/** Divides a fraction by the greatest common divisor of its terms */
+	static void reduce(uint64& num, uint64& den)
+	{
+		uint64 a = num, b = den;
+
+		while (b != 0)
+		{
+			const uint64 t = a % b;
+			a = b;
+			b = t;
+		}
+
+		num /= a;
+		den /= a;
+	}
+
+private:
+
+	uint64 tickNum;
+	uint64 tickDen;
+
+	/* Tick scaling for the rate skew: SIM_SKEW_DENOMINATOR / (SIM_SKEW_DENOMINATOR + ppb) */
+	uint64 skewNum;
+	uint64 skewDen;
+
+	/* Tick scaling for the time scale: SIM_TIME_SCALE_DENOMINATOR / (scale * SIM_TIME_SCALE_DENOMINATOR) */
+	uint64 scaleNum;
+	uint64 scaleDen;
+
+};
+
+#endif
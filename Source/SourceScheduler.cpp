@@ -0,0 +1,166 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SourceScheduler.h"
+
+SourceScheduler::SourceScheduler(int numWorkers, uint32 affinityMask_) : affinityMask(affinityMask_)
+{
+
+	for (int i = 0; i < jmax(1, numWorkers); i++)
+		workers.add(new Worker(this, i));
+
+}
+
+SourceScheduler::~SourceScheduler()
+{
+	stop();
+}
+
+void SourceScheduler::start(const Array<SourceSim*>& sources)
+{
+
+	stop();
+
+	activeSources = sources;
+
+	for (auto source : activeSources)
+	{
+		source->beginAcquisition();
+		queue.push({ source->getNextDeadline(), source });
+	}
+
+	for (auto worker : workers)
+	{
+		if (affinityMask != 0)
+			worker->setAffinityMask(affinityMask);
+
+		worker->startThread();
+	}
+
+}
+
+void SourceScheduler::stop()
+{
+
+	for (auto worker : workers)
+		worker->signalThreadShouldExit();
+
+	for (auto worker : workers)
+	{
+		worker->notify();
+		worker->stopThread(1000);
+	}
+
+	for (auto source : activeSources)
+		source->endAcquisition();
+
+	activeSources.clear();
+
+	while (!queue.empty())
+		queue.pop();
+
+}
+
+bool SourceScheduler::isRunning() const
+{
+
+	for (auto worker : workers)
+		if (worker->isThreadRunning())
+			return true;
+
+	return false;
+
+}
+
+void SourceScheduler::takeDueSources(Worker* worker, std::vector<SourceSim*>& batch)
+{
+
+	steady_clock::time_point deadline;
+
+	batch.clear();
+
+	{
+		const ScopedLock lock(queueLock);
+
+		if (queue.empty())
+		{
+			deadline = steady_clock::now() + milliseconds(1);
+		}
+		else
+		{
+			deadline = queue.top().deadline;
+
+			if (deadline <= steady_clock::now())
+			{
+				//Sources due on the same tick go together, but leave the other workers their share
+				const size_t maxBatch = (size_t) jmax(1, (activeSources.size() + workers.size() - 1) / workers.size());
+
+				while (!queue.empty() && queue.top().deadline == deadline && batch.size() < maxBatch)
+				{
+					batch.push_back(queue.top().source);
+					queue.pop();
+				}
+
+				return;
+			}
+		}
+	}
+
+	//Sleep until shortly before the earliest deadline, then yield until it is due
+	SourceSim::pace(worker, deadline - steady_clock::now());
+
+}
+
+void SourceScheduler::reschedule(const std::vector<SourceSim*>& batch)
+{
+	const ScopedLock lock(queueLock);
+
+	for (auto source : batch)
+		queue.push({ source->getNextDeadline(), source });
+}
+
+SourceScheduler::Worker::Worker(SourceScheduler* scheduler_, int index)
+	: Thread("SourceScheduler " + String(index)), scheduler(scheduler_)
+{
+}
+
+void SourceScheduler::Worker::run()
+{
+
+	//Sized once so the steady-state loop never allocates
+	batch.reserve((size_t) jmax(1, scheduler->activeSources.size()));
+
+	while (!threadShouldExit())
+	{
+		scheduler->takeDueSources(this, batch);
+
+		if (!batch.empty())
+		{
+			for (auto source : batch)
+				source->processPacket();
+
+			scheduler->reschedule(batch);
+		}
+	}
+
+}
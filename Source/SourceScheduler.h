@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SOURCESCHEDULER_H__
+#define __SOURCESCHEDULER_H__
+
+#include "SourceSim.h"
+
+#include <DataThreadHeaders.h>
+
+#include <queue>
+#include <vector>
+
+/**
+
+	Services many SourceSim objects from a small pool of worker threads.
+
+	Every source sits in a single queue ordered by the deadline of its next
+	packet. A worker takes the earliest source once its deadline has passed,
+	generates that packet and puts the source back with its next deadline.
+	So a source is never handled by two workers at once, and the thread count
+	no longer grows with the number of probes.
+
+	Sources on the shared master timebase often fall due on exactly the same
+	tick (AP, LFP and NIDAQ all finish a 10 ms packet together). A worker takes
+	such sources as one batch, up to an even share per worker, so they cost a
+	single wakeup and a single pass through the queue lock.
+
+	@see SourceSim, SourceThread
+
+*/
+class SourceScheduler
+{
+public:
+
+	SourceScheduler(int numWorkers, uint32 affinityMask);
+	~SourceScheduler();
+
+	/** Starts servicing the given sources; they must not run their own threads */
+	void start(const Array<SourceSim*>& sources);
+
+	/** Stops all workers and ends acquisition on every source */
+	void stop();
+
+	bool isRunning() const;
+
+private:
+
+	class Worker : public Thread
+	{
+	public:
+		Worker(SourceScheduler* scheduler, int index);
+		void run() override;
+	private:
+		SourceScheduler* scheduler;
+		std::vector<SourceSim*> batch;
+	};
+
+	struct Entry
+	{
+		steady_clock::time_point deadline;
+		SourceSim* source;
+
+		bool operator>(const Entry& other) const { return deadline > other.deadline; }
+	};
+
+	/* Takes the due sources sharing the earliest deadline off the queue, or leaves batch empty after sleeping towards it */
+	void takeDueSources(Worker* worker, std::vector<SourceSim*>& batch);
+
+	void reschedule(const std::vector<SourceSim*>& batch);
+
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+	CriticalSection queueLock;
+
+	Array<SourceSim*> activeSources;
+	OwnedArray<Worker> workers;
+	uint32 affinityMask;
+
+	JUCE_DECLARE_NON_COPYABLE(SourceScheduler);
+
+};
+
+#endif
@@ -1,5 +1,8 @@
 #include "SourceSim.h"
 
+#include <cmath>
+#include <thread>
+
 SourceSim::SourceSim(String name, int channels, float sampleRate) : Thread(name)
 {
 	risingEdgeProcessed = false;
@@ -7,12 +10,29 @@ SourceSim::SourceSim(String name, int channels, float sampleRate) : Thread(name)
 
 	this->name = name;
 	numChannels = channels;
-	packetSize = 500;
+	analogInputs = false;
+	packetSize = DEFAULT_PACKET_SIZE;
 	this->sampleRate = sampleRate;
 
 	clkEnabled = true;
-	clk_period = 1; //s
-	clk_tol = 0.001; //sc
+	clkPeriodChanged = false;
+	eventCode = 0;
+	lastRisingEdgeSampleNum = 0;
+	lastFallingEdgeSampleNum = 0;
+	clk_freq = 1; //Hz
+	clk_tol = 0; //ppm
+	seed = 0;
+	derived = false;
+	bufferSize = 0;
+	rateSkewPpm = 0;
+	timeScale = 1.0;
+	scheduleOffsetTicks = 0;
+	unpaced = false;
+	timebase.setRate(sampleRate, rateSkewPpm, timeScale);
+
+	numDeadlineResyncs = 0;
+
+	packet.configure(numChannels, packetSize);
 	
 }
 
@@ -20,24 +40,77 @@ SourceSim::~SourceSim()
 {
 }
 
-void SourceSim::timerCallback()
+void SourceSim::setNoiseRms(float rms)
+{
+	if (rms > 0)
+		noise = new NoiseGenerator(numChannels, rms, seed);
+	else
+		noise = nullptr;
+}
+
+void SourceSim::setColoredNoise(float rms, float alpha, float correlationLength)
+{
+	if (rms > 0)
+		coloredNoise = new ColoredNoise(numChannels, sampleRate, rms, alpha, correlationLength, seed);
+	else
+		coloredNoise = nullptr;
+}
+
+void SourceSim::setRateSkew(double ppm)
+{
+	rateSkewPpm = ppm;
+	timebase.setRate(sampleRate, rateSkewPpm, timeScale);
+}
+
+void SourceSim::setTimeScale(double scale)
 {
+	//TTL edges are scheduled on the sample counter, so the clock period scales with the pacing
+	timeScale = scale;
+	timebase.setRate(sampleRate, rateSkewPpm, timeScale);
+}
+
+void SourceSim::setUnpaced(bool enable)
+{
+	unpaced = enable;
+
+	if (decimator != nullptr)
+		decimator->backpressure = unpaced;
+}
+
+void SourceSim::setPacketSize(int samples)
+{
+	packetSize = jmax(1, samples);
+	packet.configure(numChannels, packetSize);
+}
+
+int SourceSim::setPacketDuration(float milliseconds)
+{
+	setPacketSize((int) std::lround(milliseconds * sampleRate / 1000.0f));
+	return packetSize;
+}
 
-	if (clkEnabled)
+int SourceSim::setBufferDuration(float milliseconds)
+{
+	//Never less than two packets, so a single late read cannot overflow the buffer
+	bufferSize = jmax(2 * packetSize, (int) std::ceil(milliseconds * sampleRate / 1000.0f));
+	return bufferSize;
+}
+
+void SourceSim::setDecimatedOutput(SourceSim* target, int factor)
+{
+	if (target != nullptr)
 	{
-		eventCode = (!(bool)eventCode);
-		if (eventCode)
-		{
-			risingEdgeReceived = true;
-			risingEdgeProcessed = false;
-		}
-		else
-		{
-			fallingEdgeReceived = true;
-			fallingEdgeProcessed = false;
-		}
+		decimator = new Decimator(numChannels, sampleRate, factor, packetSize);
+		decimator->output = target->buffer;
+		decimator->quantizer = &target->quantizer;
+		decimator->outputStats = &target->stats;
+		decimator->backpressure = unpaced;
+		target->derived = true;
+	}
+	else
+	{
+		decimator = nullptr;
 	}
-
 }
 
 void SourceSim::updateClk(bool enable)
@@ -47,55 +120,187 @@ void SourceSim::updateClk(bool enable)
 
 void SourceSim::updateClkFreq(int freq, float tol)
 {
-	stopTimer();
 
-	clk_period = 1 / (float)freq;
+	if (freq <= 0)
+		return;
 
-	startTimer(1000 * clk_period / 2);
+	clk_freq = freq;
+	clk_tol = tol;
+
+	clkPeriodChanged = true;
 
 }
 
-void SourceSim::run()
+void SourceSim::pace(Thread* thread, steady_clock::duration remaining)
+{
+
+	const steady_clock::duration sleep = remaining - microseconds(PACING_SPIN_US);
+
+	//Whole milliseconds through the (interruptible) thread wait, the remainder with a precise sleep
+	if (sleep >= milliseconds(1))
+		thread->wait((int) duration_cast<milliseconds>(sleep).count());
+	else if (sleep > steady_clock::duration::zero())
+		std::this_thread::sleep_for(sleep);
+	else
+		Thread::yield();
+
+}
+
+void SourceSim::waitUntil(steady_clock::time_point deadline)
+{
+
+	//Sleep through most of the interval, then yield for the last fraction of a millisecond
+	while (!threadShouldExit())
+	{
+		steady_clock::duration remaining = deadline - steady_clock::now();
+
+		if (remaining <= steady_clock::duration::zero())
+			return;
+
+		pace(this, remaining);
+	}
+
+}
+
+void SourceSim::beginAcquisition()
 {
 
 	//Keep track of total number of samples generated since starting acquisition
 	numSamples = 0;
 
-	//Start the TTL clock (50% duty cycle @ 1 / clk_period Hz)
-	startTimer(1000 * clk_period  / 2);
+	//Start the TTL clock low (50% duty cycle @ clk_freq Hz); edges follow the sample counter
+	eventCode = 0;
+	clkPeriodChanged = false;
+	resetClock();
 
-	t1 = high_resolution_clock::now();
+	//All packet deadlines are absolute offsets from this instant on a monotonic clock;
+	//sources given the same epoch share sample 0 no matter when their threads start
+	startTime = (epoch != steady_clock::time_point()) ? epoch : steady_clock::now();
+	scheduleOffsetTicks = 0;
+	numDeadlineResyncs = 0;
+	stats.reset();
 
-	int count = 0;
+	//A derived band never runs beginAcquisition itself; its counters start with the band feeding it
+	if (decimator != nullptr && decimator->outputStats != nullptr)
+		decimator->outputStats->reset();
 
-	while (!threadShouldExit())
+	//The packet arena is sized at construction; acquisition must not reallocate it
+	arenaAllocationsAtStart = packet.getNumAllocations();
+
+}
+
+void SourceSim::resetClock()
+{
+	//Half period = sampleRate / (2 * clk_freq) samples, as an exact fraction at the timebase's rate resolution
+	syncClock.setTolerance(clk_tol * 1e-6, seed);
+	syncClock.setHalfPeriod(std::llround(sampleRate * SIM_RATE_DENOMINATOR), 2 * (int64) clk_freq * SIM_RATE_DENOMINATOR, numSamples);
+}
+
+void SourceSim::seek(int64 sampleIndex)
+{
+	//Every generator derives its state from the sample index; the TTL level follows the edges skipped
+	const int64 edgesSkipped = syncClock.seek(sampleIndex);
+
+	if (clkEnabled && (edgesSkipped & 1))
+		eventCode = !eventCode;
+
+	numSamples = sampleIndex;
+	risingEdgeProcessed = true;
+	fallingEdgeProcessed = true;
+}
+
+int64 SourceSim::getNextDeadlineTick() const
+{
+	//A packet is due once the tick its last sample would have been acquired at has passed
+	return scheduleOffsetTicks + timebase.getTick(numSamples + packetSize);
+}
+
+steady_clock::time_point SourceSim::getNextDeadline() const
+{
+	//Unpaced sources are always due; only the buffer reader holds them back
+	if (unpaced)
+		return startTime;
+
+	return startTime + duration_cast<steady_clock::duration>(nanoseconds(getNextDeadlineTick()));
+}
+
+void SourceSim::processPacket()
+{
+
+	//Late packets are generated back-to-back until the schedule is met again;
+	//if we fall too far behind, drop the backlog and re-anchor the schedule instead
+	const steady_clock::time_point packetStart = steady_clock::now();
+	steady_clock::duration lateness = unpaced ? steady_clock::duration::zero() : packetStart - getNextDeadline();
+
+	if (lateness > milliseconds(MAX_CATCH_UP_MS))
 	{
+		scheduleOffsetTicks += duration_cast<nanoseconds>(lateness).count();
+		numDeadlineResyncs++;
+	}
 
-		//Stop the thread to simulate 
-		wait((int)(1000.0f * (float) packetSize / (float) sampleRate));
+	//Pick up a clock frequency change from the editor at the packet boundary
+	if (clkPeriodChanged.exchange(false))
+		resetClock();
 
-		//Wait some more until sampling time has completely passed 
-		//while (duration_cast<duration<double>>(high_resolution_clock::now()-t1).count() < packetSize / sampleRate)
+	//Generate the data packet
+	const int64 firstSample = numSamples;
 
-		//Set event received flag for data packet generation based on events
-		if (risingEdgeReceived)
-		{
-			lastRisingEdgeSampleNum = numSamples;
-			risingEdgeReceived = false;
-		}
-		else if (fallingEdgeReceived)
-		{
-			lastFallingEdgeSampleNum = numSamples;
-			fallingEdgeReceived = false;
-		}
+	generateDataPacket();
 
-		//Generate the data packet
-		generateDataPacket();
+	const int numRows = (int) (numSamples - firstSample);
 
-		//Reset the sampling check time
-		t1 = high_resolution_clock::now();
+	//Feed the same (unquantized) packet to the derived band, if any
+	if (decimator != nullptr)
+		decimator->process(packet.samples, packet.eventCodes, numRows, firstSample);
+
+	quantizer.process(packet.samples, numRows * numChannels);
+
+	//Hand the whole packet to the buffer in one locked call; whatever does not fit is lost,
+	//unless the source is unpaced, in which case it waits for the reader (backpressure)
+	int64 blockedNs = 0;
+	const int numWritten = packet.writeTo(buffer, numRows, numChannels, unpaced, blockedNs);
+	stats.addBufferWrite(numRows, numWritten, buffer->getNumSamples(), blockedNs);
+
+	//Publish counters for the editor; drift is measured against the master timebase, ignoring re-anchors
+	const steady_clock::time_point packetEnd = steady_clock::now();
+	const steady_clock::time_point sampleTime = startTime +
+		duration_cast<steady_clock::duration>(nanoseconds(timebase.getTick(numSamples)));
+
+	stats.addPacket(numRows,
+		duration_cast<nanoseconds>(packetEnd - packetStart).count() - blockedNs,
+		duration_cast<nanoseconds>(lateness).count(),
+		duration_cast<nanoseconds>(packetEnd - sampleTime).count());
+
+}
+
+void SourceSim::endAcquisition()
+{
+
+#ifdef DEBUG
+	std::cout << name << ": packet arena allocations during acquisition: "
+		<< packet.getNumAllocations() - arenaAllocationsAtStart << std::endl;
+#endif
+	jassert(packet.getNumAllocations() == arenaAllocationsAtStart);
+
+}
+
+void SourceSim::run()
+{
+
+	beginAcquisition();
+
+	while (!threadShouldExit())
+	{
+
+		waitUntil(getNextDeadline());
+
+		if (threadShouldExit())
+			break;
+
+		processPacket();
 
 	}
 
-	stopTimer();
-}
\ No newline at end of file
+	endAcquisition();
+
+}
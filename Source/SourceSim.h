@@ -3,16 +3,34 @@
 
 #include <DataThreadHeaders.h>
 
+#include "Oscillator.h"
+#include "PacketArena.h"
+#include "SyncClock.h"
+#include "SpikeSynth.h"
+#include "NoiseGenerator.h"
+#include "ColoredNoise.h"
+#include "Decimator.h"
+#include "Quantizer.h"
+#include "SourceStats.h"
+#include "SampleTimebase.h"
+
 #include <ctime>
 #include <ratio>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+
+/* Pacing: how close to a deadline we stop sleeping and start yielding, and how far behind we catch up */
+#define PACING_SPIN_US 500
+#define MAX_CATCH_UP_MS 1000
 
-#define PI 3.14159f
+/* Packet size used until setPacketSize / setPacketDuration is called */
+#define DEFAULT_PACKET_SIZE 500
 
 using namespace std::chrono;
 
 /* Source Simulator Class to simulate actual sources generating data into OpenEphys */
-class SourceSim : public Thread, public Timer
+class SourceSim : public Thread
 {
 public:
 
@@ -23,115 +41,282 @@ public:
 
 	void run() override;
 
+	/* Packet-level steps of run(), also driven directly by SourceScheduler */
+	void beginAcquisition();
+	steady_clock::time_point getNextDeadline() const;
+	void processPacket();
+	void endAcquisition();
+
 	DataBuffer* buffer;
 
+	/* Buffer capacity in sample rows, derived from a duration so every rate gets the same slack */
+	int bufferSize;
+	int setBufferDuration(float milliseconds);
+
+	/* Preallocated packet storage reused by generateDataPacket */
+	PacketArena packet;
+
 	int numChannels;
+
+	/* True for analog input (ADC) sources such as the NIDAQ, false for headstage channels */
+	bool analogInputs;
+
+	/* Sample rows per packet; set before acquisition and before setDecimatedOutput / setBufferDuration */
 	int packetSize;
+	void setPacketSize(int samples);
+	int setPacketDuration(float milliseconds);
+
 	float sampleRate;
 	int64 numSamples;
 
 	bool clkEnabled;
 	uint64 eventCode;
-	float clk_period;
-	float clk_tol;
-
-	void timerCallback();
-	bool risingEdgeReceived;
-	bool fallingEdgeReceived;
-	int lastRisingEdgeSampleNum;
-	int lastFallingEdgeSampleNum;
+	int clk_freq; //Hz
+	float clk_tol; //ppm
+
+	/* Seeds the per-source random streams (clock model, spikes, noise) so runs are reproducible */
+	int64 seed;
+
+	/* Gaussian background noise added by band generators that support it (RMS in uV, 0 = off) */
+	ScopedPointer<NoiseGenerator> noise;
+	void setNoiseRms(float rms);
+
+	/* 1/f^alpha background with spatial correlation along the shank (RMS in uV, 0 = off) */
+	ScopedPointer<ColoredNoise> coloredNoise;
+	void setColoredNoise(float rms, float alpha, float correlationLength);
+
+	/* Converts each packet to ADC counts before it is buffered (disabled = float output) */
+	Quantizer quantizer;
+
+	/* Optional decimated copy of every packet, written to another source's buffer (e.g. LFP from AP) */
+	ScopedPointer<Decimator> decimator;
+	void setDecimatedOutput(SourceSim* target, int factor);
+
+	/* Set when another source produces this source's data; derived sources are never run */
+	bool derived;
+
+	int64 lastRisingEdgeSampleNum;
+	int64 lastFallingEdgeSampleNum;
 	bool risingEdgeProcessed;
 	bool fallingEdgeProcessed;
 
-	high_resolution_clock::time_point t1;
-	high_resolution_clock::time_point t2;
+	/* TTL clock edges are scheduled on the sample counter, not on wall time */
+	SyncClock syncClock;
+
+	/* Restarts the TTL clock at the current sample from clk_freq and clk_tol; the half period is kept exact */
+	void resetClock();
+
+	/* Jumps the generators to sampleIndex as if they had run from sample 0 (after beginAcquisition).
+	   Lets soak tests check multi-day sample positions without generating every sample before them */
+	void seek(int64 sampleIndex);
+
+	/* Set by updateClkFreq from the message thread, applied at the next packet boundary */
+	std::atomic<bool> clkPeriodChanged;
+
+	/* Advances the TTL clock to the given sample and toggles eventCode on an edge */
+	inline void advanceClock(int64 sampleIndex)
+	{
+		if (syncClock.isEdge(sampleIndex) && clkEnabled)
+		{
+			eventCode = !eventCode;
+
+			if (eventCode)
+			{
+				lastRisingEdgeSampleNum = sampleIndex;
+				risingEdgeProcessed = false;
+			}
+			else
+			{
+				lastFallingEdgeSampleNum = sampleIndex;
+				fallingEdgeProcessed = false;
+			}
+		}
+	}
+
+	/* Tick 0 of the master timebase for this run; packet deadlines are measured from here */
+	steady_clock::time_point startTime;
+
+	/* Instant of sample 0, shared by every source started together (unset = when beginAcquisition runs) */
+	steady_clock::time_point epoch;
+
+	/* Sample index -> master tick, from the exact nominal rate and the optional rate skew */
+	SampleTimebase timebase;
+	double rateSkewPpm;
+	void setRateSkew(double ppm);
+
+	/* Simulation speed relative to the wall clock (2 = twice real time); samples and timestamps are unaffected */
+	double timeScale;
+	void setTimeScale(double scale);
+
+	/* Ticks the schedule has been pushed back by re-anchoring (0 while the source keeps up) */
+	int64 scheduleOffsetTicks;
+
+	/* Master tick by which the next packet is due */
+	int64 getNextDeadlineTick() const;
+
+	/* Free-running load generator: no pacing, and buffer writes wait for the reader instead of dropping */
+	bool unpaced;
+	void setUnpaced(bool enable);
+
+	/* Number of times the source fell more than MAX_CATCH_UP_MS behind and re-anchored */
+	int64 numDeadlineResyncs;
+
+	/* Live counters read by the editor's status view */
+	SourceStats stats;
+
+	/* Blocks until the deadline (or until the thread is asked to exit) */
+	void waitUntil(steady_clock::time_point deadline);
+
+	/* Sleeps thread for up to remaining minus the spin margin, or yields inside the margin.
+	   Gaps under a millisecond use a precise sleep rather than busy-waiting on Thread::wait(0) */
+	static void pace(Thread* thread, steady_clock::duration remaining);
+
+	/* Arena allocation count when acquisition started, checked when it ends */
+	int64 arenaAllocationsAtStart;
 
 	void updateClk(bool enable);
 	void updateClkFreq(int freq, float tol);
 
-	/*Add data as a function of processor sample rate + audio card sample rate */ 
+	/* Fills the packet arena and advances numSamples; processPacket() buffers the result */ 
 	virtual void generateDataPacket() = 0;
 
 };
 
-/* Simulates expected Neuropixels AP Band when probe is in air (60 Hz) */
+/* Simulates expected Neuropixels AP Band when probe is in air (60 Hz); also used as the wideband (WB) stream of probes without a separate LFP band */
 class NPX_AP_BAND : public SourceSim
 {
 
 public:
-	NPX_AP_BAND(int nChannels) : SourceSim("AP", nChannels, 30000.0f) {};
+	NPX_AP_BAND(int nChannels, String name = "AP") : SourceSim(name, nChannels, 30000.0f), oscillator(60.0, 30000.0) {};
 	~NPX_AP_BAND() {};
 
+	/* Mixes spikes from numUnits simulated units into the band (0 = sine only) */
+	void setNumUnits(int numUnits)
+	{
+		if (numUnits > 0)
+			spikes = new SpikeSynth(numChannels, sampleRate, numUnits, seed);
+		else
+			spikes = nullptr;
+	}
+
 	void generateDataPacket() {
 
-		std::vector<float> samples;
+		float* samples = packet.samples;
+		int64* timestamps = packet.timestamps;
+		uint64* eventCodes = packet.eventCodes;
+
+		const int64 firstSample = numSamples;
+
+		oscillator.setSampleIndex(numSamples);
 
 		for (int i = 0; i < packetSize; i++)
 		{
 
-			//Generate sine wave at 60 Hz with amplitude 1000
-			for (int j = 0; j < numChannels; j++)
-			{
-				samples.push_back(1000.0f*sin(2*PI*(float)numSamples/(sampleRate / 60.0f)));
-			}
+			advanceClock(numSamples);
+
+			//Generate sine wave at 60 Hz with amplitude 1000, identical on all channels
+			const float value = 1000.0f * oscillator.next();
+			std::fill(&samples[i * numChannels], &samples[i * numChannels] + numChannels, value);
+
 			numSamples++;
-			buffer->addToBuffer(&samples[0], &numSamples, &eventCode, 1);
-			samples.clear();
+			timestamps[i] = numSamples;
+			eventCodes[i] = eventCode;
 		}
 
+		if (noise != nullptr)
+			noise->addNoise(samples, packetSize, firstSample);
+
+		if (coloredNoise != nullptr)
+			coloredNoise->addNoise(samples, packetSize, firstSample);
+
+		if (spikes != nullptr)
+			spikes->addSpikes(samples, packetSize, firstSample);
+
 	};
+
+private:
+
+	Oscillator oscillator;
+	ScopedPointer<SpikeSynth> spikes;
 };
 
 /* Simulates expected Neuropixels LFP Band when probe is in air (60 Hz) */
 class NPX_LFP_BAND : public SourceSim
 {
 public:
-	NPX_LFP_BAND(int nChannels) : SourceSim("LFP", nChannels, 2500.0f) {};
+	NPX_LFP_BAND(int nChannels) : SourceSim("LFP", nChannels, 2500.0f), oscillator(60.0, 2500.0) {};
 	~NPX_LFP_BAND() {};
 
 	void generateDataPacket() {
 
-		std::vector<float> samples;
+		float* samples = packet.samples;
+		int64* timestamps = packet.timestamps;
+		uint64* eventCodes = packet.eventCodes;
+
+		const int64 firstSample = numSamples;
+
+		oscillator.setSampleIndex(numSamples);
 
 		for (int i = 0; i < packetSize; i++)
 		{
+			advanceClock(numSamples);
+
+			//Generate sine wave at 60 Hz with amplitude 1000, sign alternating across channels
+			const float value = 1000.0f * oscillator.next();
+			float* row = &samples[i * numChannels];
 			for (int j = 0; j < numChannels; j++)
 			{
-				//Generate sine wave at 60 Hz with amplitude 1000
-				samples.push_back((j % 2 == 0 ? 1.0f : -1.0f) * 1000.0f*sin(2*PI*(float)numSamples/(sampleRate / 60.0f)));
+				row[j] = (j % 2 == 0) ? value : -value;
 			}
 			numSamples++;
-			buffer->addToBuffer(&samples[0], &numSamples, &eventCode, 1);
-			samples.clear();
+			timestamps[i] = numSamples;
+			eventCodes[i] = eventCode;
 		}
 
+		if (noise != nullptr)
+			noise->addNoise(samples, packetSize, firstSample);
+
+		if (coloredNoise != nullptr)
+			coloredNoise->addNoise(samples, packetSize, firstSample);
 	};
+
+private:
+
+	Oscillator oscillator;
 };
 
 /* Simulates NIDAQ Analog + Digital acquisition w/ 60 Hz sine wave */
 class NIDAQ : public SourceSim
 {
 public:
-	NIDAQ(int nChannels) : SourceSim("AI", nChannels, 30000.0f) {};
+	NIDAQ(int nChannels) : SourceSim("AI", nChannels, 30000.0f), oscillator(10.0, 30000.0) { analogInputs = true; };
 	~NIDAQ() {};
 
 	void generateDataPacket() {
 
-		std::vector<float> samples;
+		float* samples = packet.samples;
+		int64* timestamps = packet.timestamps;
+		uint64* eventCodes = packet.eventCodes;
+
+		oscillator.setSampleIndex(numSamples);
 
 		for (int i = 0; i < packetSize; i++)
 		{
-			for (int j = 0; j < numChannels; j++)
-			{
-				//Generate sine wave at 10 Hz with amplitude 1000
-				samples.push_back(1000.0f*sin(2*PI*(float)numSamples/(sampleRate / 10.0f)));
-			}
+			advanceClock(numSamples);
+
+			//Generate sine wave at 10 Hz with amplitude 1000
+			const float value = 1000.0f * oscillator.next();
+			std::fill(&samples[i * numChannels], &samples[i * numChannels] + numChannels, value);
+
 			numSamples++;
-			buffer->addToBuffer(&samples[0], &numSamples, &eventCode, 1);
-			samples.clear();
+			timestamps[i] = numSamples;
+			eventCodes[i] = eventCode;
 		}
-
 	};
+
+private:
+
+	Oscillator oscillator;
 };
 
 #define INITIATION_POTENTIAL_START_TIME_IN_MS 0
@@ -144,13 +329,6 @@ public:
 #define THRESHOLD_POTENTIAL_IN_MV -25.0f
 #define PEAK_DEPOLARIZATION_POTENTIAL_IN_MV -100.0f
 
-static unsigned int g_seed;
-
-inline int fastrand() {
-  g_seed = (214013*g_seed+2531011);
-  return (g_seed>>16)&0x7FFF;
-}
-
 /* Simulates AP signal based on crude piece-wise function */
 class APTrain : public SourceSim
 {
@@ -160,13 +338,21 @@ public:
 
 	void generateDataPacket() {
 
-		std::vector<float> samples;
-		float sample_out;
+		float* samples = packet.samples;
+		int64* timestamps = packet.timestamps;
+		uint64* eventCodes = packet.eventCodes;
 
 		for (int i = 0; i < packetSize; i++)
 		{
 
-			float time = 1000.0f * (float)(numSamples - lastRisingEdgeSampleNum) / sampleRate;
+			advanceClock(numSamples);
+
+			/* TODO: Implement more meaningful simulated resting membrane potential */
+			float sample_out = 0;
+
+			//Time since the edge from the exact 64-bit sample difference, so the shape is the same on day three
+			const int64 samplesSinceEdge = numSamples - lastRisingEdgeSampleNum;
+			float time = (float) (1000.0 * (double) samplesSinceEdge / sampleRate);
 
 			if (!risingEdgeProcessed)
 			{
@@ -190,28 +376,17 @@ public:
 					risingEdgeProcessed = true;
 				}
 			}
-			else
-			{
-				/* TODO: Implement more meaningful simulated resting membrane potential instead of rand() numbers */
-				/*
-				srand((unsigned) std::time(NULL));
-				float randomNoise = (float) fastrand() / 2147.5;
-				sample_out = RESTING_MEMBRANE_POTENTATION_IN_MV + (randomNoise - 1.0f)*5.0f;
-				*/
-				sample_out = 0;
-			}
 			
 
 			for (int j = 0; j < numChannels; j++)
 			{
-				samples.push_back(sample_out);
+				samples[i * numChannels + j] = sample_out;
 			}
 			numSamples++;
-			buffer->addToBuffer(&samples[0], &numSamples, &eventCode, 1);
-			samples.clear();
+			timestamps[i] = numSamples;
+			eventCodes[i] = eventCode;
 
 		}
-
 	};
 
 
@@ -24,10 +24,81 @@
 #include "SourceThread.h"
 #include "SourceSimEditor.h"
 
+#define STATUS_REFRESH_MS 250
+#define STATUS_HEADER_HEIGHT 35
+#define STATUS_ROW_HEIGHT 20
+
+/* Thread affinity masks are 32 bits wide */
+#define MAX_AFFINITY_CORES 32
+
+/* Parses a core list ("0-3,8") or a hex mask ("0xff00") into an affinity mask; fails on cores the machine lacks */
+static bool parseAffinityMask(const String& text, uint32& mask)
+{
+	const int numCores = jmin(MAX_AFFINITY_CORES, SystemStats::getNumCpus());
+	const uint64 available = (numCores >= 32) ? 0xFFFFFFFFull : ((1ull << numCores) - 1);
+	const String trimmed = text.trim().toLowerCase();
+
+	if (trimmed.startsWith("0x"))
+	{
+		const String digits = trimmed.substring(2);
+
+		if (digits.isEmpty() || digits.length() > 8 || !digits.containsOnly("0123456789abcdef"))
+			return false;
+
+		mask = (uint32) digits.getHexValue32();
+		return (mask & ~available) == 0;
+	}
+
+	uint64 bits = 0;
+
+	for (auto& item : StringArray::fromTokens(trimmed, ",", ""))
+	{
+		const String first = item.upToFirstOccurrenceOf("-", false, false).trim();
+		const String last = item.contains("-") ? item.fromFirstOccurrenceOf("-", false, false).trim() : first;
+
+		if (first.isEmpty() || last.isEmpty() || !first.containsOnly("0123456789") || !last.containsOnly("0123456789"))
+			return false;
+
+		const int firstCore = first.getIntValue();
+		const int lastCore = last.getIntValue();
+
+		if (firstCore > lastCore || lastCore >= numCores)
+			return false;
+
+		for (int core = firstCore; core <= lastCore; core++)
+			bits |= 1ull << core;
+	}
+
+	//An empty list means no pinning
+	mask = (uint32) bits;
+	return true;
+}
+
+/* Formats an affinity mask as a core list, e.g. 0x10f -> "0-3,8" ("" = no pinning) */
+static String formatAffinityMask(uint32 mask)
+{
+	StringArray ranges;
+
+	for (int core = 0; core < MAX_AFFINITY_CORES; core++)
+	{
+		if ((mask & (1u << core)) == 0)
+			continue;
+
+		int last = core;
+		while (last + 1 < MAX_AFFINITY_CORES && (mask & (1u << (last + 1))) != 0)
+			last++;
+
+		ranges.add(last > core ? String(core) + "-" + String(last) : String(core));
+		core = last;
+	}
+
+	return ranges.joinIntoString(",");
+}
+
 TextEditor* NumericEntry::createEditorComponent()
 {
 	TextEditor* const ed = Label::createEditorComponent();
-    ed->setInputRestrictions(4, "0123456789.");
+    ed->setInputRestrictions(maxLength, allowedCharacters);
     return ed;
 }
 
@@ -40,6 +111,7 @@ SourceSimEditor::SourceSimEditor(GenericProcessor* parentNode, SourceThread* t,
     canvas = nullptr;
 
     tabText = "Source Sim";
+    desiredWidth = 735;
 
 	clockFreqLabel = new Label("clkFreqLabel", "CLK (Hz)");
 	clockFreqLabel->setBounds(5,30,50,20);
@@ -59,14 +131,14 @@ SourceSimEditor::SourceSimEditor(GenericProcessor* parentNode, SourceThread* t,
 	clockTolLabel->setBounds(95,30,30,20);
 	addAndMakeVisible(clockTolLabel);
 
-	clockTolEntry = new NumericEntry("clkFreqEntry", "0");
+	clockTolEntry = new NumericEntry("clkFreqEntry", "0", 5);
 	clockTolEntry->setBounds(120,30,40,20);
 	clockTolEntry->setEditable(false, true);
 	clockTolEntry->setColour(Label::backgroundColourId, Colours::grey);
 	clockTolEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
 	clockTolEntry->setJustificationType(Justification::centredRight);
 	clockTolEntry->setText("0", juce::NotificationType::sendNotification);
-	clockTolEntry->setEnabled(false);
+	clockTolEntry->setTooltip("Sync clock tolerance (ppm): fixed offset, random walk and per-edge jitter");
 	clockTolEntry->addListener(this);
 	addAndMakeVisible(clockTolEntry);
 
@@ -83,9 +155,15 @@ SourceSimEditor::SourceSimEditor(GenericProcessor* parentNode, SourceThread* t,
 	quantityLabel->setBounds(130,55,40,20);
 	addAndMakeVisible(quantityLabel);
 
-	NPXDeviceLabel = new Label("NPX1 Probe", "NPX1 Probe");
-	NPXDeviceLabel->setBounds(5,80,120,20);
-	addAndMakeVisible(NPXDeviceLabel);
+	//Probe profile: channel count, bands, rates and ADC resolution of every probe
+	probeProfileComboBox = new ComboBox("probeProfileComboBox");
+	probeProfileComboBox->setBounds(5,80,88,20);
+	for (int i = 0; i < NUM_PROBE_PROFILES; i++)
+		probeProfileComboBox->addItem(ProbeProfile::get(i).name, i + 1);
+	probeProfileComboBox->setSelectedId(t->probeProfile + 1, dontSendNotification);
+	probeProfileComboBox->setTooltip("Probe type simulated on every probe");
+	probeProfileComboBox->addListener(this);
+	addAndMakeVisible(probeProfileComboBox);
 
 	NPXChannelsEntry = new NumericEntry("NPXChannelsEntry", "0");
 	NPXChannelsEntry->setBounds(95,80,40,20);
@@ -131,6 +209,290 @@ SourceSimEditor::SourceSimEditor(GenericProcessor* parentNode, SourceThread* t,
 	NIDAQQuantityEntry->addListener(this);
 	addAndMakeVisible(NIDAQQuantityEntry);
 
+	//Threading: 0 scheduler threads keeps one thread per source
+	schedulerThreadsLabel = new Label("THR:", "THR:");
+	schedulerThreadsLabel->setBounds(175,30,40,20);
+	addAndMakeVisible(schedulerThreadsLabel);
+
+	schedulerThreadsEntry = new NumericEntry("schedulerThreadsEntry", "0");
+	schedulerThreadsEntry->setBounds(215,30,40,20);
+	schedulerThreadsEntry->setEditable(false, true);
+	schedulerThreadsEntry->setColour(Label::backgroundColourId, Colours::grey);
+	schedulerThreadsEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	schedulerThreadsEntry->setJustificationType(Justification::centredRight);
+	schedulerThreadsEntry->setText(String(t->numSchedulerThreads), juce::NotificationType::dontSendNotification);
+	schedulerThreadsEntry->addListener(this);
+	addAndMakeVisible(schedulerThreadsEntry);
+
+	affinityMaskLabel = new Label("CPU:", "CPU:");
+	affinityMaskLabel->setBounds(175,55,35,20);
+	addAndMakeVisible(affinityMaskLabel);
+
+	affinityMaskEntry = new NumericEntry("affinityMaskEntry", "", 24, "0123456789abcdefABCDEFx,-");
+	affinityMaskEntry->setBounds(205,55,50,20);
+	affinityMaskEntry->setEditable(false, true);
+	affinityMaskEntry->setColour(Label::backgroundColourId, Colours::grey);
+	affinityMaskEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	affinityMaskEntry->setJustificationType(Justification::centredRight);
+	affinityMaskEntry->setText(formatAffinityMask(t->affinityMask), juce::NotificationType::dontSendNotification);
+	affinityMaskEntry->setTooltip("Cores all simulator threads may run on, as a list (0-3,8) or hex mask (0xff00); empty = no pinning");
+	affinityMaskEntry->addListener(this);
+	addAndMakeVisible(affinityMaskEntry);
+
+	playbackButton = new UtilityButton("PLAYBACK", Font("Small Text", 12, Font::plain));
+	playbackButton->setBounds(175,80,80,20);
+	playbackButton->setTooltip("Replay an int16 recording (.dat/.bin); cancel the file dialog to remove it");
+	playbackButton->addListener(this);
+	addAndMakeVisible(playbackButton);
+
+	//Simulated units per probe, mixed into the AP band
+	unitsLabel = new Label("SPK:", "SPK:");
+	unitsLabel->setBounds(175,105,40,20);
+	addAndMakeVisible(unitsLabel);
+
+	unitsEntry = new NumericEntry("unitsEntry", "0");
+	unitsEntry->setBounds(215,105,40,20);
+	unitsEntry->setEditable(false, true);
+	unitsEntry->setColour(Label::backgroundColourId, Colours::grey);
+	unitsEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	unitsEntry->setJustificationType(Justification::centredRight);
+	unitsEntry->setText(String(t->numUnitsPerProbe), juce::NotificationType::dontSendNotification);
+	unitsEntry->setTooltip("Simulated units per probe (Poisson spike trains in the AP band)");
+	unitsEntry->addListener(this);
+	addAndMakeVisible(unitsEntry);
+
+	//Background noise RMS per band (uV)
+	apNoiseLabel = new Label("AP uV:", "AP uV:");
+	apNoiseLabel->setBounds(260,30,55,20);
+	addAndMakeVisible(apNoiseLabel);
+
+	apNoiseEntry = new NumericEntry("apNoiseEntry", "0");
+	apNoiseEntry->setBounds(315,30,40,20);
+	apNoiseEntry->setEditable(false, true);
+	apNoiseEntry->setColour(Label::backgroundColourId, Colours::grey);
+	apNoiseEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	apNoiseEntry->setJustificationType(Justification::centredRight);
+	apNoiseEntry->setText(String(t->apNoiseRms), juce::NotificationType::dontSendNotification);
+	apNoiseEntry->setTooltip("AP band Gaussian noise RMS (uV)");
+	apNoiseEntry->addListener(this);
+	addAndMakeVisible(apNoiseEntry);
+
+	lfpNoiseLabel = new Label("LFP uV:", "LFP uV:");
+	lfpNoiseLabel->setBounds(260,55,55,20);
+	addAndMakeVisible(lfpNoiseLabel);
+
+	lfpNoiseEntry = new NumericEntry("lfpNoiseEntry", "0");
+	lfpNoiseEntry->setBounds(315,55,40,20);
+	lfpNoiseEntry->setEditable(false, true);
+	lfpNoiseEntry->setColour(Label::backgroundColourId, Colours::grey);
+	lfpNoiseEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	lfpNoiseEntry->setJustificationType(Justification::centredRight);
+	lfpNoiseEntry->setText(String(t->lfpNoiseRms), juce::NotificationType::dontSendNotification);
+	lfpNoiseEntry->setTooltip("LFP band 1/f background RMS (uV); also the LFP content of wideband probes");
+	lfpNoiseEntry->addListener(this);
+	addAndMakeVisible(lfpNoiseEntry);
+
+	lfpWhiteNoiseLabel = new Label("LFP wn:", "LFP wn:");
+	lfpWhiteNoiseLabel->setBounds(635,30,55,20);
+	addAndMakeVisible(lfpWhiteNoiseLabel);
+
+	lfpWhiteNoiseEntry = new NumericEntry("lfpWhiteNoiseEntry", "0");
+	lfpWhiteNoiseEntry->setBounds(690,30,40,20);
+	lfpWhiteNoiseEntry->setEditable(false, true);
+	lfpWhiteNoiseEntry->setColour(Label::backgroundColourId, Colours::grey);
+	lfpWhiteNoiseEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	lfpWhiteNoiseEntry->setJustificationType(Justification::centredRight);
+	lfpWhiteNoiseEntry->setText(String(t->lfpWhiteNoiseRms), juce::NotificationType::dontSendNotification);
+	lfpWhiteNoiseEntry->setTooltip("LFP band white Gaussian noise RMS (uV), added on top of the 1/f background");
+	lfpWhiteNoiseEntry->addListener(this);
+	addAndMakeVisible(lfpWhiteNoiseEntry);
+
+	//LFP noise spectrum (1/f^alpha) and spatial correlation length (channels)
+	lfpAlphaLabel = new Label("1/f a:", "1/f a:");
+	lfpAlphaLabel->setBounds(260,80,55,20);
+	addAndMakeVisible(lfpAlphaLabel);
+
+	lfpAlphaEntry = new NumericEntry("lfpAlphaEntry", "0");
+	lfpAlphaEntry->setBounds(315,80,40,20);
+	lfpAlphaEntry->setEditable(false, true);
+	lfpAlphaEntry->setColour(Label::backgroundColourId, Colours::grey);
+	lfpAlphaEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	lfpAlphaEntry->setJustificationType(Justification::centredRight);
+	lfpAlphaEntry->setText(String(t->lfpNoiseAlpha), juce::NotificationType::dontSendNotification);
+	lfpAlphaEntry->setTooltip("LFP noise spectral exponent alpha (0-2)");
+	lfpAlphaEntry->addListener(this);
+	addAndMakeVisible(lfpAlphaEntry);
+
+	lfpCorrelationLabel = new Label("Corr:", "Corr:");
+	lfpCorrelationLabel->setBounds(260,105,55,20);
+	addAndMakeVisible(lfpCorrelationLabel);
+
+	lfpCorrelationEntry = new NumericEntry("lfpCorrelationEntry", "0");
+	lfpCorrelationEntry->setBounds(315,105,40,20);
+	lfpCorrelationEntry->setEditable(false, true);
+	lfpCorrelationEntry->setColour(Label::backgroundColourId, Colours::grey);
+	lfpCorrelationEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	lfpCorrelationEntry->setJustificationType(Justification::centredRight);
+	lfpCorrelationEntry->setText(String(t->lfpNoiseCorrelation), juce::NotificationType::dontSendNotification);
+	lfpCorrelationEntry->setTooltip("LFP noise spatial correlation length (channels)");
+	lfpCorrelationEntry->addListener(this);
+	addAndMakeVisible(lfpCorrelationEntry);
+
+	//Derive each LFP band from its AP band instead of generating it separately
+	lfpFromApButton = new UtilityButton("LFP<AP", Font("Small Text", 12, Font::plain));
+	lfpFromApButton->setBounds(360,30,80,20);
+	lfpFromApButton->setClickingTogglesState(true);
+	lfpFromApButton->setToggleState(t->lfpFromAp, dontSendNotification);
+	lfpFromApButton->setTooltip("Decimate the LFP band from the AP band (12:1): coherent content and an exact sample ratio, but more CPU than generating it and no 1/f background");
+	lfpFromApButton->addListener(this);
+	addAndMakeVisible(lfpFromApButton);
+
+	//Integer ADC output with per-band NPX gain
+	quantizeButton = new UtilityButton("INT16", Font("Small Text", 12, Font::plain));
+	quantizeButton->setBounds(360,55,80,20);
+	quantizeButton->setClickingTogglesState(true);
+	quantizeButton->setToggleState(t->quantizeOutput, dontSendNotification);
+	quantizeButton->setTooltip("Output NPX bands as ADC counts with hardware bit-volts");
+	quantizeButton->addListener(this);
+	addAndMakeVisible(quantizeButton);
+
+	const ProbeProfile& gainProfile = ProbeProfile::get(0);
+
+	apGainComboBox = new ComboBox("apGainComboBox");
+	apGainComboBox->setBounds(360,80,80,20);
+	apGainComboBox->setTooltip("AP band gain");
+	for (int i = 0; i < NUM_PROBE_GAINS; i++)
+		apGainComboBox->addItem("AP x" + String((int) gainProfile.gains[i]), i + 1);
+	apGainComboBox->setSelectedId(t->apGainIndex + 1, dontSendNotification);
+	apGainComboBox->addListener(this);
+	addAndMakeVisible(apGainComboBox);
+
+	lfpGainComboBox = new ComboBox("lfpGainComboBox");
+	lfpGainComboBox->setBounds(360,105,80,20);
+	lfpGainComboBox->setTooltip("LFP band gain");
+	for (int i = 0; i < NUM_PROBE_GAINS; i++)
+		lfpGainComboBox->addItem("LFP x" + String((int) gainProfile.gains[i]), i + 1);
+	lfpGainComboBox->setSelectedId(t->lfpGainIndex + 1, dontSendNotification);
+	lfpGainComboBox->addListener(this);
+	addAndMakeVisible(lfpGainComboBox);
+
+	//DataBuffer depth, in time so fast and slow bands get the same slack
+	bufferLabel = new Label("BUF ms:", "BUF ms:");
+	bufferLabel->setBounds(445,30,55,20);
+	addAndMakeVisible(bufferLabel);
+
+	bufferEntry = new NumericEntry("bufferEntry", "0", 5);
+	bufferEntry->setBounds(495,30,40,20);
+	bufferEntry->setEditable(false, true);
+	bufferEntry->setColour(Label::backgroundColourId, Colours::grey);
+	bufferEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	bufferEntry->setJustificationType(Justification::centredRight);
+	bufferEntry->setText(String(t->bufferMs), juce::NotificationType::dontSendNotification);
+	bufferEntry->setTooltip("Buffer depth per source (1-10000 ms); overflowing samples are counted as lost in the canvas");
+	bufferEntry->addListener(this);
+	addAndMakeVisible(bufferEntry);
+
+	//Packet duration per source type (1 ms = low-latency mode)
+	apPacketLabel = new Label("AP ms:", "AP ms:");
+	apPacketLabel->setBounds(445,55,55,20);
+	addAndMakeVisible(apPacketLabel);
+
+	apPacketEntry = new NumericEntry("apPacketEntry", "0");
+	apPacketEntry->setBounds(495,55,40,20);
+	apPacketEntry->setEditable(false, true);
+	apPacketEntry->setColour(Label::backgroundColourId, Colours::grey);
+	apPacketEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	apPacketEntry->setJustificationType(Justification::centredRight);
+	apPacketEntry->setText(String(t->apPacketMs), juce::NotificationType::dontSendNotification);
+	apPacketEntry->setTooltip("AP/WB band (and playback) packet duration (ms)");
+	apPacketEntry->addListener(this);
+	addAndMakeVisible(apPacketEntry);
+
+	lfpPacketLabel = new Label("LFP ms:", "LFP ms:");
+	lfpPacketLabel->setBounds(445,80,55,20);
+	addAndMakeVisible(lfpPacketLabel);
+
+	lfpPacketEntry = new NumericEntry("lfpPacketEntry", "0");
+	lfpPacketEntry->setBounds(495,80,40,20);
+	lfpPacketEntry->setEditable(false, true);
+	lfpPacketEntry->setColour(Label::backgroundColourId, Colours::grey);
+	lfpPacketEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	lfpPacketEntry->setJustificationType(Justification::centredRight);
+	lfpPacketEntry->setText(String(t->lfpPacketMs), juce::NotificationType::dontSendNotification);
+	lfpPacketEntry->setTooltip("LFP band packet duration (ms)");
+	lfpPacketEntry->addListener(this);
+	addAndMakeVisible(lfpPacketEntry);
+
+	niPacketLabel = new Label("NI ms:", "NI ms:");
+	niPacketLabel->setBounds(445,105,55,20);
+	addAndMakeVisible(niPacketLabel);
+
+	niPacketEntry = new NumericEntry("niPacketEntry", "0");
+	niPacketEntry->setBounds(495,105,40,20);
+	niPacketEntry->setEditable(false, true);
+	niPacketEntry->setColour(Label::backgroundColourId, Colours::grey);
+	niPacketEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	niPacketEntry->setJustificationType(Justification::centredRight);
+	niPacketEntry->setText(String(t->niPacketMs), juce::NotificationType::dontSendNotification);
+	niPacketEntry->setTooltip("NIDAQ packet duration (ms)");
+	niPacketEntry->addListener(this);
+	addAndMakeVisible(niPacketEntry);
+
+	//Per-device sample clock error against the master timebase
+	rateSkewLabel = new Label("SKEW:", "SKEW:");
+	rateSkewLabel->setBounds(540,30,50,20);
+	addAndMakeVisible(rateSkewLabel);
+
+	rateSkewEntry = new NumericEntry("rateSkewEntry", "0");
+	rateSkewEntry->setBounds(590,30,40,20);
+	rateSkewEntry->setEditable(false, true);
+	rateSkewEntry->setColour(Label::backgroundColourId, Colours::grey);
+	rateSkewEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	rateSkewEntry->setJustificationType(Justification::centredRight);
+	rateSkewEntry->setText(String(t->rateSkewPpm), juce::NotificationType::dontSendNotification);
+	rateSkewEntry->setTooltip("Max sample-rate skew per device (ppm); each probe and NIDAQ device gets a fixed offset within it");
+	rateSkewEntry->addListener(this);
+	addAndMakeVisible(rateSkewEntry);
+
+	//Free-running load generator for throughput tests of the downstream chain
+	unpacedButton = new UtilityButton("UNPACED", Font("Small Text", 12, Font::plain));
+	unpacedButton->setBounds(540,55,90,20);
+	unpacedButton->setClickingTogglesState(true);
+	unpacedButton->setToggleState(t->unpaced, dontSendNotification);
+	unpacedButton->setTooltip("Generate as fast as the signal chain consumes data (backpressure, no drops); see x real in the canvas");
+	unpacedButton->addListener(this);
+	addAndMakeVisible(unpacedButton);
+
+	timeScaleLabel = new Label("SPEED:", "SPEED:");
+	timeScaleLabel->setBounds(540,80,50,20);
+	addAndMakeVisible(timeScaleLabel);
+
+	timeScaleEntry = new NumericEntry("timeScaleEntry", String(t->timeScale));
+	timeScaleEntry->setBounds(590,80,40,20);
+	timeScaleEntry->setEditable(false, true);
+	timeScaleEntry->setColour(Label::backgroundColourId, Colours::grey);
+	timeScaleEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	timeScaleEntry->setJustificationType(Justification::centredRight);
+	timeScaleEntry->setTooltip("Playback speed relative to real time (0.01-100); samples, timestamps and TTL periods in samples are unchanged");
+	timeScaleEntry->addListener(this);
+	addAndMakeVisible(timeScaleEntry);
+
+	playbackBitVoltsLabel = new Label("PB uV:", "PB uV:");
+	playbackBitVoltsLabel->setBounds(540,105,50,20);
+	addAndMakeVisible(playbackBitVoltsLabel);
+
+	playbackBitVoltsEntry = new NumericEntry("playbackBitVoltsEntry", String(t->playbackBitVolts), 6);
+	playbackBitVoltsEntry->setBounds(590,105,40,20);
+	playbackBitVoltsEntry->setEditable(false, true);
+	playbackBitVoltsEntry->setColour(Label::backgroundColourId, Colours::grey);
+	playbackBitVoltsEntry->setColour(Label::backgroundWhenEditingColourId, Colours::white);
+	playbackBitVoltsEntry->setJustificationType(Justification::centredRight);
+	playbackBitVoltsEntry->setTooltip("Playback uV/bit for recordings without gain information (Kilosort params.py, bare .bin)");
+	playbackBitVoltsEntry->addListener(this);
+	addAndMakeVisible(playbackBitVoltsEntry);
+
+	updateProbeControls();
+
 
 }
 
@@ -154,8 +516,8 @@ void SourceSimEditor::labelTextChanged (Label* label)
 	}
 	else if (label == clockTolEntry)
 	{
-		/*Restrict to % of clk freq */
-		if (!(tol <= (float)freq / 10))
+		/* Tolerance is in ppm of the clock frequency, restrict to 1% (the entry takes 5 digits) */
+		if (!(tol >= 0 && tol <= 10000))
 		{
 			label->setText("0", juce::NotificationType::sendNotification);
 			tol = 0;
@@ -164,9 +526,10 @@ void SourceSimEditor::labelTextChanged (Label* label)
 	else if (label == NPXChannelsEntry)
 	{
 		int channels = NPXChannelsEntry->getText().getIntValue();
-		if (channels < 0 || channels > 384)
+		const int maxChannels = ProbeProfile::get(thread->probeProfile).maxChannels;
+		if (channels < 0 || channels > maxChannels)
 		{
-		    channels = 384;
+		    channels = maxChannels;
             NPXChannelsEntry->setText(String(channels), juce::NotificationType::sendNotification);
 		}
         thread->updateNPXChannels(channels);
@@ -174,7 +537,7 @@ void SourceSimEditor::labelTextChanged (Label* label)
 	else if (label == NPXQuantityEntry)
 	{
 		int numProbes = NPXQuantityEntry->getText().getIntValue();
-		if (numProbes < 0 || numProbes > 10)
+		if (numProbes < 0 || numProbes > MAX_PROBES)
 		{
 		    numProbes = 1;
             NPXQuantityEntry->setText(String(numProbes), juce::NotificationType::sendNotification);
@@ -194,13 +557,116 @@ void SourceSimEditor::labelTextChanged (Label* label)
 	else if (label == NIDAQQuantityEntry)
 	{
 		int numDevices = NIDAQQuantityEntry->getText().getIntValue();
-		if (numDevices < 0 || numDevices > 2)
+		if (numDevices < 0 || numDevices > MAX_NI_DEVICES)
 		{
 		    numDevices = 1;
             NIDAQQuantityEntry->setText(String(numDevices), juce::NotificationType::sendNotification);
 		}
 		thread->updateNIDAQDeviceCount(numDevices);
 	}
+	else if (label == apNoiseEntry || label == lfpNoiseEntry || label == lfpWhiteNoiseEntry)
+	{
+		float apRms = apNoiseEntry->getText().getFloatValue();
+		float lfpRms = lfpNoiseEntry->getText().getFloatValue();
+		float lfpWhiteRms = lfpWhiteNoiseEntry->getText().getFloatValue();
+		thread->updateNoiseRms(apRms, lfpRms, lfpWhiteRms);
+	}
+	else if (label == lfpAlphaEntry || label == lfpCorrelationEntry)
+	{
+		float alpha = lfpAlphaEntry->getText().getFloatValue();
+		if (alpha < 0 || alpha > 2)
+		{
+		    alpha = jlimit(0.0f, 2.0f, alpha);
+            lfpAlphaEntry->setText(String(alpha), juce::NotificationType::dontSendNotification);
+		}
+		float correlation = lfpCorrelationEntry->getText().getFloatValue();
+		if (correlation < 0 || correlation > 64)
+		{
+		    correlation = jlimit(0.0f, 64.0f, correlation);
+            lfpCorrelationEntry->setText(String(correlation), juce::NotificationType::dontSendNotification);
+		}
+		thread->updateLfpNoiseShape(alpha, correlation);
+	}
+	else if (label == unitsEntry)
+	{
+		int numUnits = unitsEntry->getText().getIntValue();
+		if (numUnits < 0)
+		{
+		    numUnits = 0;
+            unitsEntry->setText(String(numUnits), juce::NotificationType::dontSendNotification);
+		}
+		thread->updateNumUnits(numUnits);
+	}
+	else if (label == schedulerThreadsEntry || label == affinityMaskEntry)
+	{
+		/* Affinity is a core list ("0-3,8") or hex mask ("0xf"); anything naming a missing core keeps the old mask */
+		int numThreads = schedulerThreadsEntry->getText().getIntValue();
+		if (numThreads < 0 || numThreads > 16)
+		{
+		    numThreads = 0;
+            schedulerThreadsEntry->setText(String(numThreads), juce::NotificationType::dontSendNotification);
+		}
+		uint32 mask = thread->affinityMask;
+		if (!parseAffinityMask(affinityMaskEntry->getText(), mask))
+			mask = thread->affinityMask;
+		affinityMaskEntry->setText(formatAffinityMask(mask), juce::NotificationType::dontSendNotification);
+		thread->updateSchedulerMode(numThreads, mask);
+	}
+	else if (label == bufferEntry)
+	{
+		float milliseconds = bufferEntry->getText().getFloatValue();
+		if (milliseconds < 1 || milliseconds > 10000)
+		{
+		    milliseconds = jlimit(1.0f, 10000.0f, milliseconds);
+            bufferEntry->setText(String(milliseconds), juce::NotificationType::dontSendNotification);
+		}
+		thread->updateBufferDuration(milliseconds);
+	}
+	else if (label == apPacketEntry || label == lfpPacketEntry || label == niPacketEntry)
+	{
+		float packetMs[3];
+		NumericEntry* entries[] = { apPacketEntry, lfpPacketEntry, niPacketEntry };
+		for (int i = 0; i < 3; i++)
+		{
+			packetMs[i] = entries[i]->getText().getFloatValue();
+			if (packetMs[i] < 1 || packetMs[i] > 1000)
+			{
+				packetMs[i] = jlimit(1.0f, 1000.0f, packetMs[i]);
+				entries[i]->setText(String(packetMs[i]), juce::NotificationType::dontSendNotification);
+			}
+		}
+		thread->updatePacketDurations(packetMs[0], packetMs[1], packetMs[2]);
+	}
+	else if (label == rateSkewEntry)
+	{
+		float ppm = rateSkewEntry->getText().getFloatValue();
+		if (ppm < 0 || ppm > 1000)
+		{
+			ppm = jlimit(0.0f, 1000.0f, ppm);
+			rateSkewEntry->setText(String(ppm), juce::NotificationType::dontSendNotification);
+		}
+		thread->updateRateSkew(ppm);
+	}
+	else if (label == timeScaleEntry)
+	{
+		float scale = timeScaleEntry->getText().getFloatValue();
+		if (scale < 0.01f || scale > 100)
+		{
+			scale = jlimit(0.01f, 100.0f, scale);
+			timeScaleEntry->setText(String(scale), juce::NotificationType::dontSendNotification);
+		}
+		thread->updateTimeScale(scale);
+	}
+	else if (label == playbackBitVoltsEntry)
+	{
+		float bitVolts = playbackBitVoltsEntry->getText().getFloatValue();
+		if (bitVolts < 0.01f || bitVolts > 100)
+		{
+			bitVolts = jlimit(0.01f, 100.0f, bitVolts);
+			playbackBitVoltsEntry->setText(String(bitVolts), juce::NotificationType::dontSendNotification);
+		}
+		thread->updatePlaybackBitVolts(bitVolts);
+	}
 
 	thread->updateClkFreq(freq, tol);
     CoreServices::updateSignalChain(this);	
@@ -209,18 +675,74 @@ void SourceSimEditor::labelTextChanged (Label* label)
 
 void SourceSimEditor::startAcquisition()
 {
+	probeProfileComboBox->setEnabled(false);
 	NPXChannelsEntry->setEnabled(false);
 	NPXQuantityEntry->setEnabled(false);
 	NIDAQChannelsEntry->setEnabled(false);
 	NIDAQQuantityEntry->setEnabled(false);
+	schedulerThreadsEntry->setEnabled(false);
+	affinityMaskEntry->setEnabled(false);
+	playbackButton->setEnabled(false);
+	lfpFromApButton->setEnabled(false);
+	quantizeButton->setEnabled(false);
+	apGainComboBox->setEnabled(false);
+	lfpGainComboBox->setEnabled(false);
+	unitsEntry->setEnabled(false);
+	apNoiseEntry->setEnabled(false);
+	lfpNoiseEntry->setEnabled(false);
+	lfpWhiteNoiseEntry->setEnabled(false);
+	lfpAlphaEntry->setEnabled(false);
+	lfpCorrelationEntry->setEnabled(false);
+	bufferEntry->setEnabled(false);
+	apPacketEntry->setEnabled(false);
+	lfpPacketEntry->setEnabled(false);
+	niPacketEntry->setEnabled(false);
+	rateSkewEntry->setEnabled(false);
+	unpacedButton->setEnabled(false);
+	timeScaleEntry->setEnabled(false);
+	playbackBitVoltsEntry->setEnabled(false);
 }
 
 void SourceSimEditor::stopAcquisition()
 {
+	probeProfileComboBox->setEnabled(true);
 	NPXChannelsEntry->setEnabled(true);
 	NPXQuantityEntry->setEnabled(true);
 	NIDAQChannelsEntry->setEnabled(true);
 	NIDAQQuantityEntry->setEnabled(true);
+	schedulerThreadsEntry->setEnabled(true);
+	affinityMaskEntry->setEnabled(true);
+	playbackButton->setEnabled(true);
+	lfpFromApButton->setEnabled(true);
+	quantizeButton->setEnabled(true);
+	apGainComboBox->setEnabled(true);
+	lfpGainComboBox->setEnabled(true);
+	unitsEntry->setEnabled(true);
+	apNoiseEntry->setEnabled(true);
+	lfpNoiseEntry->setEnabled(true);
+	lfpWhiteNoiseEntry->setEnabled(true);
+	lfpAlphaEntry->setEnabled(true);
+	lfpCorrelationEntry->setEnabled(true);
+	bufferEntry->setEnabled(true);
+	apPacketEntry->setEnabled(true);
+	niPacketEntry->setEnabled(true);
+	rateSkewEntry->setEnabled(true);
+	unpacedButton->setEnabled(true);
+	timeScaleEntry->setEnabled(true);
+	playbackBitVoltsEntry->setEnabled(true);
+	updateProbeControls();
+}
+
+void SourceSimEditor::updateProbeControls()
+{
+	//Gain only applies to probes with selectable gain, and LFP controls to probes with an LFP band
+	const ProbeProfile& profile = ProbeProfile::get(thread->probeProfile);
+
+	apGainComboBox->setEnabled(profile.selectableGain);
+	lfpGainComboBox->setEnabled(profile.selectableGain && profile.hasLfpBand());
+	lfpFromApButton->setEnabled(profile.hasLfpBand());
+	lfpPacketEntry->setEnabled(profile.hasLfpBand());
+	lfpWhiteNoiseEntry->setEnabled(profile.hasLfpBand());
 }
 
 void SourceSimEditor::collapsedStateChanged()
@@ -231,6 +753,18 @@ void SourceSimEditor::collapsedStateChanged()
 void SourceSimEditor::comboBoxChanged(ComboBox* comboBox)
 {
 
+	if (comboBox == probeProfileComboBox)
+	{
+		thread->updateProbeProfile(probeProfileComboBox->getSelectedId() - 1);
+		NPXChannelsEntry->setText(String(thread->numChannelsPerProbe), dontSendNotification);
+		updateProbeControls();
+		CoreServices::updateSignalChain(this);
+	}
+	else if (comboBox == apGainComboBox || comboBox == lfpGainComboBox)
+	{
+		thread->setAllGains(0, 0, apGainComboBox->getSelectedId() - 1, lfpGainComboBox->getSelectedId() - 1);
+		CoreServices::updateSignalChain(this);
+	}
 
 }
 
@@ -239,7 +773,32 @@ void SourceSimEditor::comboBoxChanged(ComboBox* comboBox)
 void SourceSimEditor::buttonEvent(Button* button)
 {
 
+	if (button == playbackButton)
+	{
+		FileChooser chooser("Select a recording to replay", thread->playbackFile, "*.dat;*.bin");
 
+		if (chooser.browseForFileToOpen())
+			thread->updatePlaybackFile(chooser.getResult());
+		else
+			thread->updatePlaybackFile(File());
+
+		playbackButton->setToggleState(thread->playbackFile.existsAsFile(), dontSendNotification);
+		CoreServices::updateSignalChain(this);
+	}
+	else if (button == lfpFromApButton)
+	{
+		thread->updateLfpFromAp(lfpFromApButton->getToggleState());
+		CoreServices::updateSignalChain(this);
+	}
+	else if (button == unpacedButton)
+	{
+		thread->updateUnpaced(unpacedButton->getToggleState());
+	}
+	else if (button == quantizeButton)
+	{
+		thread->updateQuantization(quantizeButton->getToggleState());
+		CoreServices::updateSignalChain(this);
+	}
 
 }
 
@@ -287,14 +846,9 @@ void SourceSimEditor::loadEditorParameters(XmlElement* xml)
 
 Visualizer* SourceSimEditor::createNewCanvas(void)
 {
-	/*
-    std::cout << "Button clicked..." << std::endl;
     GenericProcessor* processor = (GenericProcessor*) getProcessor();
-    std::cout << "Got processor." << std::endl;
     canvas = new SourceSimCanvas(processor, this, thread);
-    std::cout << "Created canvas." << std::endl;
-	*/
-    return nullptr;
+    return canvas;
 }
 
 
@@ -305,41 +859,17 @@ SourceSimCanvas::SourceSimCanvas(GenericProcessor* p, SourceSimEditor* editor_,
 
     processor = (SourceNode*) p;
 
-/*
     sourceSimViewport = new Viewport();
 
-	XmlElement source_sim_info = thread->getInfoXml();
-
-	if (source_sim_info.hasTagName("NEUROPIX-PXI"))
-	{
-		forEachXmlChildElement(source_sim_info, e)
-		{
-			if (e->hasTagName("BASESTATION"))
-			{
-				slot = e->getIntAttribute("slot");
-
-				forEachXmlChildElement(*e, e2)
-				{
-					if (e2->hasTagName("PROBE"))
-					{
-						port = e2->getIntAttribute("port");
-
-						std::cout << "Creating interface for " << slot << ":" << port << std::endl;
-
-						SourceSimInterface* sourceSimInterface = new SourceSimInterface(source_sim_info, slot, port, thread, (NeuropixEditor*)p->getEditor());
-						sourceSimInterfaces.add(neuropixInterface);
-					}
-				}
-			}
-		}
-	}
+    //One status table covering every source
+    sourceSimInterfaces.add(new SourceSimInterface(XmlElement("SOURCE_SIM"), 0, thread, editor));
 
     sourceSimViewport->setViewedComponent(sourceSimInterfaces[0], false);
     addAndMakeVisible(sourceSimViewport);
 
     resized();
     update();
-	*/
+
 }
 
 SourceSimCanvas::~SourceSimCanvas()
@@ -381,7 +911,7 @@ void SourceSimCanvas::resized()
     sourceSimViewport->setBounds(0,0,getWidth(),getHeight());
 
 	for (int i = 0; i < sourceSimInterfaces.size(); i++)
-		sourceSimInterfaces[i]->setBounds(0,0,getWidth()-sourceSimViewport->getScrollBarThickness(), 600);
+		sourceSimInterfaces[i]->setBounds(0,0,getWidth()-sourceSimViewport->getScrollBarThickness(), sourceSimInterfaces[i]->getDesiredHeight());
 }
 
 void SourceSimCanvas::setParameter(int x, float f)
@@ -422,6 +952,14 @@ SourceSimInterface::SourceSimInterface(XmlElement info_, int _id, SourceThread*
     cursorType = MouseCursor::NormalCursor;
     addMouseListener(this, true);
 
+    //Poll the lock-free source counters a few times per second
+    startTimer(STATUS_REFRESH_MS);
+
+}
+
+int SourceSimInterface::getDesiredHeight() const
+{
+    return jmax(600, STATUS_HEADER_HEIGHT + STATUS_ROW_HEIGHT * (thread->sources.size() + 1));
 }
 
 SourceSimInterface::~SourceSimInterface()
@@ -514,11 +1052,74 @@ MouseCursor SourceSimInterface::getMouseCursor()
 void SourceSimInterface::paint(Graphics& g)
 {
 
+    const int x[] = { 10, 80, 170, 250, 320, 390, 460, 530, 600, 670, 740, 810, 880, 950 };
+    const char* headings[] = { "Source", "Packets", "Samples", "Gen us", "Max us", "Load %", "Late us", "Start us", "Stalls", "Lost", "Peak %", "Wait %", "x real", "Drift ms" };
+    const int numColumns = 14;
+
+    g.fillAll(Colours::darkgrey);
+    g.setFont(Font("Small Text", 13, Font::plain));
+
+    g.setColour(Colours::lightgrey);
+    for (int column = 0; column < numColumns; column++)
+        g.drawText(headings[column], x[column], 10, 80, STATUS_ROW_HEIGHT, Justification::left);
+
+    double channelSamplesPerSecond = 0;
+
+    for (int i = 0; i < thread->sources.size(); i++)
+    {
+        const SourceSim* source = thread->sources[i];
+        const SourceStats::Snapshot stats = source->stats.getSnapshot();
+
+        //Share of the wall-clock budget (scaled by SPEED) spent generating: above 100% the source cannot keep up
+        const double sampleTimeNs = 1e9 * (double) stats.samples / source->sampleRate;
+        const double budgetNs = (double) source->timebase.getTick(stats.samples);
+        const double load = budgetNs > 0 ? 100.0 * (double) stats.totalGenerationNs / budgetNs : 0.0;
+        const double driftMs = (double) stats.driftNs * 1e-6;
+        const double peakFill = source->bufferSize > 0 ? 100.0 * (double) stats.highWaterMark / source->bufferSize : 0.0;
+
+        //Sustained rate relative to real time up to the last packet: ~SPEED when paced, the chain's limit when unpaced
+        const double elapsedNs = budgetNs + (double) stats.driftNs;
+        const double realTime = elapsedNs > 0 ? sampleTimeNs / elapsedNs : 0.0;
+        const double waitPercent = elapsedNs > 0 ? 100.0 * (double) stats.blockedNs / elapsedNs : 0.0;
+
+        channelSamplesPerSecond += realTime * source->sampleRate * source->numChannels;
+
+        //Unpaced sources run ahead of or behind real time by design; only lost data counts against them
+        const bool struggling = stats.bufferStalls > 0 || (!source->unpaced && (load > 100.0 || driftMs > MAX_CATCH_UP_MS));
+
+        String columns[] = {
+            source->name + " " + String(i),
+            source->derived ? String("derived") : String(stats.packets),
+            String(stats.samples),
+            String(stats.lastGenerationNs / 1000),
+            String(stats.maxGenerationNs / 1000),
+            String(load, 1),
+            String(stats.lastLatenessNs / 1000),
+            String(stats.startLatenessNs / 1000),
+            String(stats.bufferStalls),
+            String(stats.overflowSamples),
+            String(peakFill, 1),
+            String(waitPercent, 1),
+            String(realTime, 2),
+            String(driftMs, 2)
+        };
+
+        const int y = STATUS_HEADER_HEIGHT + STATUS_ROW_HEIGHT * i;
+
+        g.setColour(struggling ? Colours::red : Colours::white);
+        for (int column = 0; column < numColumns; column++)
+            g.drawText(columns[column], x[column], y, 80, STATUS_ROW_HEIGHT, Justification::left);
+    }
+
+    g.setColour(Colours::lightgrey);
+    g.drawText("Total: " + String(channelSamplesPerSecond * 1e-6, 2) + " M channel-samples/s",
+        x[0], STATUS_HEADER_HEIGHT + STATUS_ROW_HEIGHT * thread->sources.size(), 400, STATUS_ROW_HEIGHT, Justification::left);
+
 }
 
 void SourceSimInterface::timerCallback()
 {
- 
+    repaint();
 }
 
 
@@ -35,9 +35,14 @@ class SourceSimInterface;
 class NumericEntry : public Label
 {
 public:
-	NumericEntry(String name, String text) : Label(name, text) {};
+	NumericEntry(String name, String text, int maxLength_ = 4, String allowedCharacters_ = "0123456789.")
+		: Label(name, text), maxLength(maxLength_), allowedCharacters(allowedCharacters_) {};
 	~NumericEntry() {};
 	virtual TextEditor* createEditorComponent() override;
+
+private:
+	int maxLength;
+	String allowedCharacters;
 };
 
 class SourceSimEditor : public VisualizerEditor, public ComboBox::Listener, public Label::Listener
@@ -60,6 +65,9 @@ public:
 
 	Visualizer* createNewCanvas(void);
 
+	/** Enables the gain and LFP controls that apply to the selected probe profile */
+	void updateProbeControls();
+
 
 private:
 
@@ -73,7 +81,7 @@ private:
 	ScopedPointer<Label> channelsLabel;
 	ScopedPointer<Label> quantityLabel;
 
-	ScopedPointer<Label> NPXDeviceLabel;
+	ScopedPointer<ComboBox> probeProfileComboBox;
 	ScopedPointer<NumericEntry> NPXChannelsEntry;
 	ScopedPointer<NumericEntry> NPXQuantityEntry;
 
@@ -81,6 +89,60 @@ private:
 	ScopedPointer<NumericEntry> NIDAQChannelsEntry;
 	ScopedPointer<NumericEntry> NIDAQQuantityEntry;
 
+	ScopedPointer<Label> schedulerThreadsLabel;
+	ScopedPointer<NumericEntry> schedulerThreadsEntry;
+
+	ScopedPointer<Label> affinityMaskLabel;
+	ScopedPointer<NumericEntry> affinityMaskEntry;
+
+	ScopedPointer<UtilityButton> playbackButton;
+	ScopedPointer<UtilityButton> lfpFromApButton;
+	ScopedPointer<UtilityButton> quantizeButton;
+
+	ScopedPointer<ComboBox> apGainComboBox;
+	ScopedPointer<ComboBox> lfpGainComboBox;
+
+	ScopedPointer<Label> unitsLabel;
+	ScopedPointer<NumericEntry> unitsEntry;
+
+	ScopedPointer<Label> apNoiseLabel;
+	ScopedPointer<NumericEntry> apNoiseEntry;
+
+	ScopedPointer<Label> lfpNoiseLabel;
+	ScopedPointer<NumericEntry> lfpNoiseEntry;
+
+	ScopedPointer<Label> lfpWhiteNoiseLabel;
+	ScopedPointer<NumericEntry> lfpWhiteNoiseEntry;
+
+	ScopedPointer<Label> lfpAlphaLabel;
+	ScopedPointer<NumericEntry> lfpAlphaEntry;
+
+	ScopedPointer<Label> lfpCorrelationLabel;
+	ScopedPointer<NumericEntry> lfpCorrelationEntry;
+
+	ScopedPointer<Label> bufferLabel;
+	ScopedPointer<NumericEntry> bufferEntry;
+
+	ScopedPointer<Label> apPacketLabel;
+	ScopedPointer<NumericEntry> apPacketEntry;
+
+	ScopedPointer<Label> lfpPacketLabel;
+	ScopedPointer<NumericEntry> lfpPacketEntry;
+
+	ScopedPointer<Label> niPacketLabel;
+	ScopedPointer<NumericEntry> niPacketEntry;
+
+	ScopedPointer<Label> rateSkewLabel;
+	ScopedPointer<NumericEntry> rateSkewEntry;
+
+	ScopedPointer<UtilityButton> unpacedButton;
+
+	ScopedPointer<Label> playbackBitVoltsLabel;
+	ScopedPointer<NumericEntry> playbackBitVoltsEntry;
+
+	ScopedPointer<Label> timeScaleLabel;
+	ScopedPointer<NumericEntry> timeScaleEntry;
+
 	Viewport* viewport;
 	SourceSimCanvas* canvas;
 	SourceThread* thread;
@@ -149,6 +211,9 @@ public:
 
 	void timerCallback();
 
+	/** Tall enough for a status row per source */
+	int getDesiredHeight() const;
+
 	int id;
 
 private:
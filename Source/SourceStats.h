@@ -0,0 +1,169 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SOURCESTATS_H__
+#define __SOURCESTATS_H__
+
+#include <DataThreadHeaders.h>
+
+#include <atomic>
+
+/**
+
+	Live performance counters for one source.
+
+	Only the thread generating the source's packets writes the counters, so
+	each update is a relaxed load and store with no read-modify-write. Any
+	thread (typically the message thread) can read them at any time through
+	getSnapshot(). Each counter is consistent on its own, but a snapshot is
+	not taken atomically across counters.
+
+*/
+class SourceStats
+{
+public:
+
+	struct Snapshot
+	{
+		int64 packets;
+		int64 samples;
+		int64 lastGenerationNs;
+		int64 maxGenerationNs;
+		int64 totalGenerationNs;
+		int64 lastLatenessNs;
+		int64 maxLatenessNs;
+		int64 startLatenessNs;
+		int64 bufferStalls;
+		int64 overflowSamples;
+		int64 highWaterMark;
+		int64 blockedNs;
+		int64 driftNs;
+	};
+
+	SourceStats() { reset(); }
+
+	void reset()
+	{
+		for (auto counter : { &packets, &samples, &lastGenerationNs, &maxGenerationNs, &totalGenerationNs,
+							  &lastLatenessNs, &maxLatenessNs, &startLatenessNs, &bufferStalls, &overflowSamples, &highWaterMark, &blockedNs, &driftNs })
+			counter->store(0, std::memory_order_relaxed);
+	}
+
+	/** Records one generated packet (generating thread only) */
+	void addPacket(int numSamples, int64 generationNs, int64 latenessNs, int64 currentDriftNs)
+	{
+		if (packets.load(std::memory_order_relaxed) == 0)
+			startLatenessNs.store(latenessNs, std::memory_order_relaxed);
+
+		add(packets, 1);
+		add(samples, numSamples);
+
+		lastGenerationNs.store(generationNs, std::memory_order_relaxed);
+		add(totalGenerationNs, generationNs);
+		raise(maxGenerationNs, generationNs);
+
+		lastLatenessNs.store(latenessNs, std::memory_order_relaxed);
+		raise(maxLatenessNs, latenessNs);
+
+		driftNs.store(currentDriftNs, std::memory_order_relaxed);
+	}
+
+	/** Records one buffer write, the fill level right after it and any time spent waiting for room (writing thread only) */
+	void addBufferWrite(int numRows, int numWritten, int bufferedSamples, int64 waitNs)
+	{
+		add(blockedNs, waitNs);
+
+		if (numWritten < numRows)
+		{
+			add(bufferStalls, 1);
+			add(overflowSamples, numRows - numWritten);
+		}
+
+		raise(highWaterMark, bufferedSamples);
+	}
+
+	Snapshot getSnapshot() const
+	{
+		Snapshot s;
+		s.packets = packets.load(std::memory_order_relaxed);
+		s.samples = samples.load(std::memory_order_relaxed);
+		s.lastGenerationNs = lastGenerationNs.load(std::memory_order_relaxed);
+		s.maxGenerationNs = maxGenerationNs.load(std::memory_order_relaxed);
+		s.totalGenerationNs = totalGenerationNs.load(std::memory_order_relaxed);
+		s.lastLatenessNs = lastLatenessNs.load(std::memory_order_relaxed);
+		s.maxLatenessNs = maxLatenessNs.load(std::memory_order_relaxed);
+		s.startLatenessNs = startLatenessNs.load(std::memory_order_relaxed);
+		s.bufferStalls = bufferStalls.load(std::memory_order_relaxed);
+		s.overflowSamples = overflowSamples.load(std::memory_order_relaxed);
+		s.highWaterMark = highWaterMark.load(std::memory_order_relaxed);
+		s.blockedNs = blockedNs.load(std::memory_order_relaxed);
+		s.driftNs = driftNs.load(std::memory_order_relaxed);
+		return s;
+	}
+
+private:
+
+	static void add(std::atomic<int64>& counter, int64 value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	static void raise(std::atomic<int64>& counter, int64 value)
+	{
+		if (value > counter.load(std::memory_order_relaxed))
+			counter.store(value, std::memory_order_relaxed);
+	}
+
+	std::atomic<int64> packets;
+	std::atomic<int64> samples;
+
+	/* Time spent inside processPacket() generating and buffering, excluding backpressure waits */
+	std::atomic<int64> lastGenerationNs;
+	std::atomic<int64> maxGenerationNs;
+	std::atomic<int64> totalGenerationNs;
+
+	/* How late the packet started relative to its deadline */
+	std::atomic<int64> lastLatenessNs;
+	std::atomic<int64> maxLatenessNs;
+
+	/* Lateness of the first packet, i.e. how far this source missed the shared start epoch */
+	std::atomic<int64> startLatenessNs;
+
+	/* Packets the DataBuffer could not take in full, and the sample rows it dropped */
+	std::atomic<int64> bufferStalls;
+	std::atomic<int64> overflowSamples;
+
+	/* Most sample rows ever waiting in the DataBuffer */
+	std::atomic<int64> highWaterMark;
+
+	/* Time spent waiting for the reader to make room (unpaced mode backpressure) */
+	std::atomic<int64> blockedNs;
+
+	/* Wall clock minus sample time since acquisition started, including any re-anchoring */
+	std::atomic<int64> driftNs;
+
+	JUCE_DECLARE_NON_COPYABLE(SourceStats);
+
+};
+
+#endif
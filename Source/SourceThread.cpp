@@ -26,11 +26,30 @@
 #include <cmath>
 
 #define NUM_PROBES 6
+#define DEFAULT_PROBE_PROFILE 0
 #define NUM_NI_DEVICES 1
-#define AP_CHANNELS 384
 #define LFP_CHANNELS 384
 #define APT_CHANNELS 384
 #define NIDAQ_CHANNELS 8
+#define AP_NOISE_RMS 10.0f
+#define LFP_NOISE_RMS 20.0f
+#define LFP_WHITE_NOISE_RMS 5.0f
+#define LFP_NOISE_ALPHA 1.0f
+#define LFP_NOISE_CORRELATION 5.0f
+
+/* Indices into the probe gain table (NPX 1.0: AP x500, LFP x250) */
+#define DEFAULT_AP_GAIN_INDEX 3
+#define DEFAULT_LFP_GAIN_INDEX 2
+#define PLAYBACK_ADC_BITS 16
+
+/* Depth of every source's DataBuffer, in milliseconds of data at that source's rate */
+#define DEFAULT_BUFFER_MS 100.0f
+
+/* Packet duration per source type; real basestations deliver blocks of a few ms */
+#define DEFAULT_PACKET_MS 10.0f
+
+/* Time between startAcquisition() and the shared epoch, enough to start every source thread */
+#define START_LEAD_MS 50
 
 DataThread* SourceThread::createDataThread(SourceNode *sn)
 {
@@ -48,9 +67,30 @@ SourceThread::SourceThread(SourceNode* sn) :
 	DataThread(sn),
 	recordingTimer(this),
     numProbes(NUM_PROBES),
-    numChannelsPerProbe(AP_CHANNELS),
+    probeProfile(DEFAULT_PROBE_PROFILE),
+    numChannelsPerProbe(ProbeProfile::get(DEFAULT_PROBE_PROFILE).numChannels),
 	numNIDevices(NUM_NI_DEVICES),
-	numChannelsPerNIDAQDevice(NIDAQ_CHANNELS)
+	numChannelsPerNIDAQDevice(NIDAQ_CHANNELS),
+	numUnitsPerProbe(0),
+	apNoiseRms(AP_NOISE_RMS),
+	lfpNoiseRms(LFP_NOISE_RMS),
+	lfpWhiteNoiseRms(LFP_WHITE_NOISE_RMS),
+	lfpNoiseAlpha(LFP_NOISE_ALPHA),
+	lfpNoiseCorrelation(LFP_NOISE_CORRELATION),
+	lfpFromAp(false),
+	quantizeOutput(false),
+	apGainIndex(DEFAULT_AP_GAIN_INDEX),
+	lfpGainIndex(DEFAULT_LFP_GAIN_INDEX),
+	playbackBitVolts(PLAYBACK_DEFAULT_BIT_VOLTS),
+	bufferMs(DEFAULT_BUFFER_MS),
+	apPacketMs(DEFAULT_PACKET_MS),
+	lfpPacketMs(DEFAULT_PACKET_MS),
+	niPacketMs(DEFAULT_PACKET_MS),
+	rateSkewPpm(0),
+	unpaced(false),
+	timeScale(1.0f),
+	numSchedulerThreads(0),
+	affinityMask(0)
 {
     generateBuffers();
 }
@@ -65,10 +105,7 @@ void SourceThread::updateClkFreq(int freq, float tol)
     std::cout << "Update clk freq: " << freq << " tol: " << tol << std::endl;
 
     for (auto source : sources)
-    {
-        if (source->isTimerRunning())
-            source->updateClkFreq(freq, tol);
-    }
+        source->updateClkFreq(freq, tol);
 }
 
 
@@ -105,6 +142,142 @@ void SourceThread::updateNIDAQDeviceCount(int count)
     sn->update();
 }
 
+void SourceThread::updateNumUnits(int units)
+{
+    numUnitsPerProbe = units;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateNoiseRms(float apRms, float lfpRms, float lfpWhiteRms)
+{
+    apNoiseRms = apRms;
+    lfpNoiseRms = lfpRms;
+    lfpWhiteNoiseRms = lfpWhiteRms;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateLfpNoiseShape(float alpha, float correlationLength)
+{
+    lfpNoiseAlpha = alpha;
+    lfpNoiseCorrelation = correlationLength;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateLfpFromAp(bool enable)
+{
+    lfpFromAp = enable;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateQuantization(bool enable)
+{
+    quantizeOutput = enable;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::setAllGains(unsigned char slot, signed char port, unsigned char apGain, unsigned char lfpGain)
+{
+    //Simulated probes share one gain setting, so slot and port are not used
+    apGainIndex = (unsigned char) jmin((int) apGain, NUM_PROBE_GAINS - 1);
+    lfpGainIndex = (unsigned char) jmin((int) lfpGain, NUM_PROBE_GAINS - 1);
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateProbeProfile(int profileIndex)
+{
+    probeProfile = jlimit(0, NUM_PROBE_PROFILES - 1, profileIndex);
+    numChannelsPerProbe = ProbeProfile::get(probeProfile).numChannels;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updatePlaybackFile(File file)
+{
+    playbackFile = file;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updatePlaybackBitVolts(float bitVolts)
+{
+    playbackBitVolts = bitVolts;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateSchedulerMode(int numThreads, uint32 mask)
+{
+    numSchedulerThreads = numThreads;
+    affinityMask = mask;
+}
+
+void SourceThread::updateBufferDuration(float milliseconds)
+{
+    bufferMs = milliseconds;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updatePacketDurations(float apMs, float lfpMs, float niMs)
+{
+    apPacketMs = apMs;
+    lfpPacketMs = lfpMs;
+    niPacketMs = niMs;
+    generateBuffers();
+    sn->update();
+}
+
+void SourceThread::updateRateSkew(float ppm)
+{
+    rateSkewPpm = ppm;
+    generateBuffers();
+    sn->update();
+}
+
+double SourceThread::getDeviceSkewPpm(int64 seed) const
+{
+    //A fixed draw in [-rateSkewPpm, rateSkewPpm] per device; a probe's bands share its crystal
+    if (rateSkewPpm <= 0)
+        return 0.0;
+
+    Philox rng((uint64) seed, RNG_STREAM_RATE_SKEW);
+    return rateSkewPpm * (2.0 * rng.nextDouble() - 1.0);
+}
+
+void SourceThread::updateUnpaced(bool enable)
+{
+    unpaced = enable;
+
+    for (auto source : sources)
+        source->setUnpaced(unpaced);
+}
+
+void SourceThread::updateTimeScale(float scale)
+{
+    timeScale = scale;
+
+    for (auto source : sources)
+        source->setTimeScale(timeScale);
+}
+
+void SourceThread::addSource(SourceSim* source, float packetMs)
+{
+    //Packet size first: the buffer and any decimator are sized from it
+    source->setPacketDuration(packetMs);
+    source->setUnpaced(unpaced);
+    source->setTimeScale(timeScale);
+    sources.add(source);
+    sourceBuffers.add(new DataBuffer(source->numChannels, source->setBufferDuration(bufferMs)));
+    source->buffer = sourceBuffers.getLast();
+    source->seed = sources.size();
+}
+
 void SourceThread::generateBuffers()
 {
 
@@ -114,26 +287,76 @@ void SourceThread::generateBuffers()
     for (int i = 0; i < numProbes; i++)
     {
 
-        //Add Neuropixels AP Band
-        sources.add(new NPX_AP_BAND(numChannelsPerProbe));
-        sourceBuffers.add(new DataBuffer(sources.getLast()->numChannels,1000));
-        sources.getLast()->buffer = sourceBuffers.getLast();
+        const ProbeProfile& profile = ProbeProfile::get(probeProfile);
+
+        //Add Neuropixels AP Band (or the single wideband stream of probes without an LFP band)
+        NPX_AP_BAND* apBand = new NPX_AP_BAND(numChannelsPerProbe, profile.hasLfpBand() ? "AP" : "WB");
+        addSource(apBand, apPacketMs);
+        apBand->setRateSkew(getDeviceSkewPpm(apBand->seed));
+        apBand->setNumUnits(numUnitsPerProbe);
+        apBand->setNoiseRms(apNoiseRms);
+
+        if (quantizeOutput)
+            apBand->quantizer.setResolution(profile.getBitVolts(apGainIndex), profile.adcBits);
+
+        if (!profile.hasLfpBand())
+        {
+            //Wideband probes carry the LFP background in the same stream
+            apBand->setColoredNoise(lfpNoiseRms, lfpNoiseAlpha, lfpNoiseCorrelation);
+            continue;
+        }
 
         //Add Neuropixels LFP Band
-        sources.add(new NPX_LFP_BAND(numChannelsPerProbe));
-        sourceBuffers.add(new DataBuffer(sources.getLast()->numChannels,1000));
-        sources.getLast()->buffer = sourceBuffers.getLast();
+        NPX_LFP_BAND* lfpBand = new NPX_LFP_BAND(numChannelsPerProbe);
+        addSource(lfpBand, lfpPacketMs);
+        lfpBand->setRateSkew(apBand->rateSkewPpm);
+
+        if (quantizeOutput)
+            lfpBand->quantizer.setResolution(profile.getBitVolts(lfpGainIndex), profile.adcBits);
+
+        //Optionally derive it from the AP band so both share content and an exact sample-count ratio.
+        //This costs more CPU than generating the band, and a derived band never generates, so it
+        //gets no noise engines of its own and carries only what the AP band contains
+        if (lfpFromAp)
+        {
+            apBand->setDecimatedOutput(lfpBand, (int) (profile.apSampleRate / profile.lfpSampleRate));
+        }
+        else
+        {
+            lfpBand->setNoiseRms(lfpWhiteNoiseRms);
+            lfpBand->setColoredNoise(lfpNoiseRms, lfpNoiseAlpha, lfpNoiseCorrelation);
+        }
 
     }
 
     // //Add NIDAQ Band
     for (int i = 0; i < numNIDevices; i++)
     {
-        sources.add(new NIDAQ(numChannelsPerNIDAQDevice));
-        sourceBuffers.add(new DataBuffer(sources.getLast()->numChannels,1000));
-        sources.getLast()->buffer = sourceBuffers.getLast();
+        addSource(new NIDAQ(numChannelsPerNIDAQDevice), niPacketMs);
+        sources.getLast()->setRateSkew(getDeviceSkewPpm(sources.getLast()->seed));
     }	
 
+    //Add recording playback
+    if (playbackFile.existsAsFile())
+    {
+        int channels = PLAYBACK_DEFAULT_CHANNELS;
+        float sampleRate = PLAYBACK_DEFAULT_SAMPLE_RATE;
+        float bitVolts = playbackBitVolts;
+
+        FilePlayback::readRecordingInfo(playbackFile, channels, sampleRate, bitVolts);
+
+        ScopedPointer<FilePlayback> playback = new FilePlayback(playbackFile, channels, sampleRate, bitVolts);
+
+        if (playback->isValid())
+        {
+            //Quantizing with the file's own bit-volts returns the recorded counts exactly
+            if (quantizeOutput)
+                playback->quantizer.setResolution(bitVolts, PLAYBACK_ADC_BITS);
+
+            addSource(playback.release(), apPacketMs);
+        }
+    }
+
 }
 
 bool SourceThread::foundInputSource()
@@ -144,11 +367,40 @@ bool SourceThread::foundInputSource()
 bool SourceThread::startAcquisition()
 {
 
-	sourceBuffers.getLast()->clear();
+	//Start every source from an empty buffer so the high-water marks describe this run only
+	for (auto buffer : sourceBuffers)
+		buffer->clear();
+
+	//Sample 0 of every subprocessor is this instant; the lead lets every thread start and wait for it
+	const steady_clock::time_point epoch = steady_clock::now() + milliseconds(START_LEAD_MS);
+
+	for (auto source : sources)
+		source->epoch = epoch;
+
+    if (numSchedulerThreads > 0)
+    {
+        //Service every source from a small pool of deadline-ordered workers
+        Array<SourceSim*> scheduledSources;
+
+        for (auto source : sources)
+            if (!source->derived)
+                scheduledSources.add(source);
 
-    for (int i = 0; i < sources.size(); i++)
+        scheduler = new SourceScheduler(numSchedulerThreads, affinityMask);
+        scheduler->start(scheduledSources);
+    }
+    else
     {
-        sources[i]->startThread();
+        for (int i = 0; i < sources.size(); i++)
+        {
+            if (sources[i]->derived)
+                continue;
+
+            if (affinityMask != 0)
+                sources[i]->setAffinityMask(affinityMask);
+
+            sources[i]->startThread();
+        }
     }
 
     this->startThread();
@@ -175,6 +427,12 @@ void SourceThread::stopRecording()
 bool SourceThread::stopAcquisition()
 {
 
+    if (scheduler != nullptr)
+    {
+        scheduler->stop();
+        scheduler = nullptr;
+    }
+
     for (auto source : sources)
         source->signalThreadShouldExit();
 
@@ -194,44 +452,17 @@ void SourceThread::setDefaultChannelNames()
 
     int absChannel = 0;
 
-    for (int i = 0; i < 2*numProbes; i+=2)
-    {
-
-        //AP
-        for (int j = 0; j < sources[i]->numChannels; j++)
-        {
-            ChannelCustomInfo info;
-            info.name = "AP" + String(j + 1);
-            info.gain = 1.0f;
-            channelInfo.set(absChannel, info);
-            absChannel++;
-        }
-
-        //LFP
-        for (int j = 0; j < sources[i+1]->numChannels; j++)
-        {
-            ChannelCustomInfo info;
-            info.name = "LFP" + String(j + 1);
-            info.gain = 1.0f;
-            channelInfo.set(absChannel, info);
-            absChannel++;
-        }
-
-    }
-
-    //NIDAQ
-    for (int i = 0; i < numNIDevices; i++)
+    //Channels are numbered per subprocessor: AP1.., LFP1.., AI1.., PB1..
+    for (auto source : sources)
     {
-
-        for (int i = 0; i < sources[sources.size()-1]->numChannels; i++)
+        for (int j = 0; j < source->numChannels; j++)
         {
             ChannelCustomInfo info;
-            info.name = "AI" + String(i + 1);
+            info.name = source->name + String(j + 1);
             info.gain = 1.0f;
             channelInfo.set(absChannel, info);
             absChannel++;
         }
-
     }
 
 }
@@ -247,9 +478,9 @@ unsigned int SourceThread::getNumSubProcessors() const
 int SourceThread::getNumDataOutputs(DataChannel::DataChannelTypes type, int subProcessorIdx) const
 {
 
-	if (type == DataChannel::DataChannelTypes::HEADSTAGE_CHANNEL && subProcessorIdx < 2 * numProbes)
+	if (type == DataChannel::DataChannelTypes::HEADSTAGE_CHANNEL && !sources[subProcessorIdx]->analogInputs)
         return sources[subProcessorIdx]->numChannels;
-	else if (type == DataChannel::DataChannelTypes::ADC_CHANNEL && subProcessorIdx >= 2 * numProbes)
+	else if (type == DataChannel::DataChannelTypes::ADC_CHANNEL && sources[subProcessorIdx]->analogInputs)
 		return sources[subProcessorIdx]->numChannels;
     
     return 0;
@@ -259,10 +490,10 @@ int SourceThread::getNumDataOutputs(DataChannel::DataChannelTypes type, int subP
 /** Returns the number of TTL channels that each subprocessor generates*/
 int SourceThread::getNumTTLOutputs(int subProcessorIdx) const 
 {
-    if (subProcessorIdx < 2 * numProbes)
+    if (!sources[subProcessorIdx]->analogInputs)
 	    return 1;
     else 
-        return numChannelsPerNIDAQDevice;
+        return sources[subProcessorIdx]->numChannels;
 }
 
 /** Returns the sample rate of the data source.*/
@@ -276,6 +507,13 @@ float SourceThread::getSampleRate(int subProcessorIdx) const
 /** Returns the volts per bit of the data source.*/
 float SourceThread::getBitVolts(const DataChannel* chan) const
 {
+
+    const SourceSim* source = sources[chan->getSubProcessorIdx()];
+
+    //Quantized sources carry ADC counts; everything else is already in sample units
+    if (source != nullptr && source->quantizer.isEnabled())
+        return source->quantizer.getBitVolts();
+
 	return 1.0f;
 }
 
@@ -26,11 +26,17 @@
 #define __SOURCESIMTHREAD_H__
 
 #include "SourceSim.h"
+#include "SourceScheduler.h"
+#include "FilePlayback.h"
+#include "ProbeProfile.h"
 
 #include <DataThreadHeaders.h>
 #include <stdio.h>
 #include <string.h>
 
+#define MAX_PROBES 32
+#define MAX_NI_DEVICES 8
+
 class SourceNode;
 class SourceThread;
 
@@ -65,9 +71,21 @@ public:
 	~SourceThread();
 
 	int numProbes;
+
+	/** Index into ProbeProfile::get(); sets bands, rates and ADC resolution for every probe */
+	int probeProfile;
+
 	int numChannelsPerProbe;
 	int numNIDevices;
 	int numChannelsPerNIDAQDevice;
+	int numUnitsPerProbe;
+	float apNoiseRms;
+
+	/** LFP background: 1/f^alpha colored noise plus an independent white (amplifier) floor, both RMS in uV */
+	float lfpNoiseRms;
+	float lfpWhiteNoiseRms;
+	float lfpNoiseAlpha;
+	float lfpNoiseCorrelation;
 
 	void generateBuffers();
 
@@ -77,6 +95,69 @@ public:
 	void updateNumProbes(int probes);
 	void updateNIDAQChannels(int channels);
 	void updateNIDAQDeviceCount(int count);
+	void updateNumUnits(int units);
+	void updateNoiseRms(float apRms, float lfpRms, float lfpWhiteRms);
+	void updateLfpNoiseShape(float alpha, float correlationLength);
+
+	/** Produce each probe's LFP band by decimating its AP band (12:1); costs more CPU than generating it and has no 1/f background */
+	bool lfpFromAp;
+
+	void updateLfpFromAp(bool enable);
+
+	/** Deliver NPX bands (and playback) as integer ADC counts with real bit-volts instead of floats */
+	bool quantizeOutput;
+
+	/** Indices into the probe profile's gain table, as set by setAllGains */
+	unsigned char apGainIndex;
+	unsigned char lfpGainIndex;
+
+	void updateQuantization(bool enable);
+	void updateProbeProfile(int profileIndex);
+
+	/** Recording replayed as an extra subprocessor (none if the file does not exist) */
+	File playbackFile;
+
+	void updatePlaybackFile(File file);
+
+	/** Playback uV per bit when the recording's metadata carries no gain information */
+	float playbackBitVolts;
+
+	void updatePlaybackBitVolts(float bitVolts);
+
+	/** DataBuffer depth per source in milliseconds; each source converts it at its own rate */
+	float bufferMs;
+
+	void updateBufferDuration(float milliseconds);
+
+	/** Packet duration in milliseconds per source type (AP/WB and playback, LFP, NIDAQ); down to 1 ms for latency tests */
+	float apPacketMs;
+	float lfpPacketMs;
+	float niPacketMs;
+
+	void updatePacketDurations(float apMs, float lfpMs, float niMs);
+
+	/** Largest sample-clock error (ppm) of a simulated device; each probe and NIDAQ device draws its own fixed skew */
+	float rateSkewPpm;
+
+	void updateRateSkew(float ppm);
+
+	/** Generate as fast as the DataBuffers drain, with backpressure instead of drops (load generator mode) */
+	bool unpaced;
+
+	void updateUnpaced(bool enable);
+
+	/** Simulation speed relative to real time (e.g. 0.5, 2, 10); sample counts, timestamps and TTL periods in samples are unchanged */
+	float timeScale;
+
+	void updateTimeScale(float scale);
+
+	/** Number of shared scheduler threads servicing all sources (0 = one thread per source) */
+	int numSchedulerThreads;
+
+	/** CPU affinity mask applied to all simulator threads (0 = no pinning) */
+	uint32 affinityMask;
+
+	void updateSchedulerMode(int numThreads, uint32 mask);
 
 	/** Returns true if the data source is connected, false otherwise.*/
 	bool foundInputSource();
@@ -176,6 +257,14 @@ private:
 
 	RecordingTimer recordingTimer;
 
+	/* Adds a source with its own packet size, DataBuffer and seed */
+	void addSource(SourceSim* source, float packetMs);
+
+	/* Reproducible rate skew for the device whose first source has this seed */
+	double getDeviceSkewPpm(int64 seed) const;
+
+	ScopedPointer<SourceScheduler> scheduler;
+
 };
 
 
@@ -0,0 +1,175 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SpikeSynth.h"
+
+#include <cmath>
+
+SpikeSynth::SpikeSynth(int numChannels_, float sampleRate_, int numUnits, int64 seed_, float gammaShape_)
+	: numChannels(numChannels_), sampleRate(sampleRate_), gammaShape(gammaShape_), seed(seed_), nextExpectedSample(-1)
+{
+
+	templateLength = jmax(1, (int) (SPIKE_TEMPLATE_DURATION_MS * sampleRate / 1000.0f));
+	refractorySamples = jmax(1, (int) (SPIKE_REFRACTORY_MS * sampleRate / 1000.0f));
+
+	buildTemplateLibrary();
+
+	//Unit properties are drawn once from the seed and stay fixed across restarts
+	rng.seed((uint64) seed, RNG_STREAM_UNITS);
+
+	//Drawn from the Philox sequence directly so a seed gives the same units with any standard library
+	auto uniform = [this](double low, double high) { return low + (high - low) * rng.nextDouble(); };
+
+	units.resize(numUnits);
+
+	for (auto& unit : units)
+	{
+		const int center = (int) (rng.nextDouble() * numChannels);
+		const float amplitude = (float) uniform(50.0, 300.0); //uV
+		const float spread = (float) uniform(1.0, 4.0); //channels
+
+		unit.firstChannel = jmax(0, center - SPIKE_SPATIAL_RADIUS);
+		unit.numChannels = jmin(numChannels, center + SPIKE_SPATIAL_RADIUS + 1) - unit.firstChannel;
+
+		for (int c = 0; c < unit.numChannels; c++)
+		{
+			const float distance = (float) (unit.firstChannel + c - center);
+			unit.spatialGain[c] = amplitude * std::exp(-distance * distance / (2.0f * spread * spread));
+		}
+
+		unit.templateIndex = (int) (rng.nextDouble() * NUM_SPIKE_TEMPLATES);
+		unit.meanInterval = jmax(1.0, sampleRate / std::exp(uniform(std::log(0.5), std::log(20.0))) - refractorySamples); //0.5 - 20 Hz
+	}
+
+	//Sized for the usual case; the lists keep their capacity, so steady state does not allocate
+	activeSpikes.reserve(2 * units.size() + 1);
+	carriedSpikes.reserve(2 * units.size() + 1);
+
+	std::vector<ScheduledSpike> storage;
+	storage.reserve(units.size() + 1);
+	schedule = decltype(schedule)(std::greater<ScheduledSpike>(), std::move(storage));
+
+}
+
+SpikeSynth::~SpikeSynth()
+{
+}
+
+void SpikeSynth::buildTemplateLibrary()
+{
+
+	//Biphasic extracellular shapes: a sharp trough followed by a broader, smaller peak
+	templates.resize(NUM_SPIKE_TEMPLATES * templateLength);
+
+	for (int k = 0; k < NUM_SPIKE_TEMPLATES; k++)
+	{
+		const float troughTime = 0.3f;
+		const float troughWidth = 0.08f + 0.02f * (float) k; //ms
+		const float peakTime = troughTime + 0.3f + 0.05f * (float) k;
+		const float peakWidth = 0.2f + 0.04f * (float) k;
+		const float peakRatio = 0.2f + 0.05f * (float) k;
+
+		for (int t = 0; t < templateLength; t++)
+		{
+			const float ms = 1000.0f * (float) t / sampleRate;
+			const float trough = (ms - troughTime) / troughWidth;
+			const float peak = (ms - peakTime) / peakWidth;
+
+			templates[k * templateLength + t] = -std::exp(-0.5f * trough * trough)
+				+ peakRatio * std::exp(-0.5f * peak * peak);
+		}
+	}
+
+}
+
+int64 SpikeSynth::drawInterval(const Unit& unit)
+{
+	return refractorySamples + (int64) (rng.nextGamma(gammaShape) * unit.meanInterval / gammaShape);
+}
+
+void SpikeSynth::reset(int64 sampleIndex)
+{
+
+	//Spike trains restarted at a given sample are reproducible regardless of what ran before
+	rng.seed((uint64) seed, RNG_STREAM_SPIKES);
+	rng.setPosition((uint64) sampleIndex << 16);
+
+	while (!schedule.empty())
+		schedule.pop();
+
+	activeSpikes.clear();
+
+	for (int i = 0; i < (int) units.size(); i++)
+		schedule.push({ sampleIndex + drawInterval(units[i]) - refractorySamples, i });
+
+	nextExpectedSample = sampleIndex;
+
+}
+
+void SpikeSynth::addSpikes(float* samples, int numSamples, int64 firstSample)
+{
+
+	//A jump in the sample counter (acquisition restart) restarts the spike trains
+	if (firstSample != nextExpectedSample)
+		reset(firstSample);
+
+	const int64 endSample = firstSample + numSamples;
+
+	//Move spikes starting in this packet from the schedule to the active list
+	while (!schedule.empty() && schedule.top().sample < endSample)
+	{
+		ScheduledSpike spike = schedule.top();
+		schedule.pop();
+
+		activeSpikes.push_back(spike);
+		schedule.push({ spike.sample + drawInterval(units[spike.unit]), spike.unit });
+	}
+
+	carriedSpikes.clear();
+
+	for (auto& spike : activeSpikes)
+	{
+		const Unit& unit = units[spike.unit];
+		const float* shape = &templates[unit.templateIndex * templateLength];
+
+		const int64 first = jmax(spike.sample, firstSample);
+		const int64 last = jmin(spike.sample + templateLength, endSample);
+
+		for (int64 s = first; s < last; s++)
+		{
+			const float value = shape[s - spike.sample];
+			float* row = samples + (s - firstSample) * numChannels + unit.firstChannel;
+
+			for (int c = 0; c < unit.numChannels; c++)
+				row[c] += value * unit.spatialGain[c];
+		}
+
+		if (spike.sample + templateLength > endSample)
+			carriedSpikes.push_back(spike);
+	}
+
+	activeSpikes.swap(carriedSpikes);
+
+	nextExpectedSample = endSample;
+
+}
@@ -0,0 +1,115 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SPIKESYNTH_H__
+#define __SPIKESYNTH_H__
+
+#include <DataThreadHeaders.h>
+
+#include "Philox.h"
+
+#include <vector>
+#include <queue>
+
+#define NUM_SPIKE_TEMPLATES 8
+#define SPIKE_TEMPLATE_DURATION_MS 2.0f
+#define SPIKE_REFRACTORY_MS 2.0f
+#define SPIKE_SPATIAL_RADIUS 8
+
+/**
+
+	Synthesizes extracellular spikes from many units into an interleaved block.
+
+	Each unit has a center channel and a Gaussian spatial footprint over its
+	neighbouring channels. It also picks one temporal shape from a shared
+	template library and fires as a gamma renewal process (shape 1 gives a
+	Poisson process with a refractory period).
+
+	Spike times are kept in a min-heap keyed on the next spike sample, so the
+	cost is proportional to the number of spikes emitted, not to the number of
+	units times samples. Spikes that straddle a packet boundary are carried
+	over to the next packet.
+
+*/
+class SpikeSynth
+{
+public:
+
+	SpikeSynth(int numChannels, float sampleRate, int numUnits, int64 seed, float gammaShape = 1.0f);
+	~SpikeSynth();
+
+	/** Adds every spike overlapping [firstSample, firstSample + numSamples) into the interleaved block */
+	void addSpikes(float* samples, int numSamples, int64 firstSample);
+
+	/** Restarts all spike trains from the given sample, reproducibly for a given seed */
+	void reset(int64 sampleIndex);
+
+	int getNumUnits() const { return (int) units.size(); }
+
+private:
+
+	struct Unit
+	{
+		int firstChannel;
+		int numChannels;
+		float spatialGain[2 * SPIKE_SPATIAL_RADIUS + 1];
+		int templateIndex;
+		double meanInterval; //samples, excluding the refractory period
+	};
+
+	struct ScheduledSpike
+	{
+		int64 sample;
+		int unit;
+
+		bool operator>(const ScheduledSpike& other) const { return sample > other.sample; }
+	};
+
+	void buildTemplateLibrary();
+	int64 drawInterval(const Unit& unit);
+
+	int numChannels;
+	float sampleRate;
+	int templateLength;
+	int refractorySamples;
+	float gammaShape;
+	int64 seed;
+
+	/* Temporal shapes, NUM_SPIKE_TEMPLATES x templateLength, unit peak amplitude */
+	std::vector<float> templates;
+
+	std::vector<Unit> units;
+
+	std::priority_queue<ScheduledSpike, std::vector<ScheduledSpike>, std::greater<ScheduledSpike>> schedule;
+
+	/* Spikes that started in an earlier packet and are still being written */
+	std::vector<ScheduledSpike> activeSpikes;
+	std::vector<ScheduledSpike> carriedSpikes;
+
+	int64 nextExpectedSample;
+
+	Philox rng;
+
+};
+
+#endif
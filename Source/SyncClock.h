@@ -0,0 +1,181 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2020 Allen Institute for Brain Science and Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __SYNCCLOCK_H__
+#define __SYNCCLOCK_H__
+
+#include <DataThreadHeaders.h>
+
+#include "Philox.h"
+#include "SampleTimebase.h"
+
+#include <cmath>
+
+/* Share of the tolerance band given to each error term of the clock model */
+#define CLK_DRIFT_SHARE 0.5
+#define CLK_WALK_SHARE 0.25
+#define CLK_JITTER_SHARE 0.25
+#define CLK_WALK_STEP 0.05
+
+/**
+	Sample-domain schedule of TTL clock edges (50% duty cycle).
+
+	Edges are placed at anchor + ceil(k * halfPeriod) for k = 1, 2, ...
+	The half period is an exact fraction (sample rate / 2f), and each
+	position is computed from the edge index in 64-bit integers rather than
+	accumulated, so a fractional half period (e.g. 30 kHz / 14 Hz) never
+	drifts, even after days of samples.
+
+	With a non-zero tolerance the clock behaves like a real oscillator. It
+	has a fixed frequency offset, a slow bounded random walk of that offset,
+	and independent jitter on every edge. The three terms together keep each
+	half period within +/- tolerance of nominal. Only the offset and the walk
+	accumulate into the phase; jitter does not.
+
+*/
+class SyncClock
+{
+public:
+
+	SyncClock() : halfPeriod(1.0), halfNum(1), halfDen(1), anchorSample(0), edgeIndex(0), nextEdgeSample(1),
+		tolerance(0.0), drift(0.0), walk(0.0), driftOffset(0.0) {}
+
+	/** Sets the frequency tolerance as a fraction of nominal (0 = ideal clock) and reseeds the error model */
+	void setTolerance(double relativeTolerance, int64 seed)
+	{
+		tolerance = relativeTolerance > 0.0 ? (relativeTolerance < 0.5 ? relativeTolerance : 0.5) : 0.0;
+
+		random.seed(seed, RNG_STREAM_CLOCK);
+		drift = tolerance * CLK_DRIFT_SHARE * (2.0 * random.nextDouble() - 1.0);
+		walk = 0.0;
+	}
+
+	/** Sets the half period to numerator / denominator samples and restarts the edge schedule at sampleIndex */
+	void setHalfPeriod(int64 numerator, int64 denominator, int64 sampleIndex)
+	{
+		if (denominator <= 0 || numerator < denominator)
+			numerator = denominator = 1;
+
+		uint64 num = (uint64) numerator, den = (uint64) denominator;
+		SampleTimebase::reduce(num, den);
+
+		halfNum = (int64) num;
+		halfDen = (int64) den;
+		halfPeriod = (double) halfNum / (double) halfDen;
+		reset(sampleIndex);
+	}
+
+	/** Restarts the schedule so the first edge falls one half period after sampleIndex */
+	void reset(int64 sampleIndex)
+	{
+		anchorSample = sampleIndex;
+		edgeIndex = 1;
+		driftOffset = 0.0;
+		nextEdgeSample = anchorSample + edgeOffset(edgeIndex);
+	}
+
+	/** Returns true if an edge falls on this sample; must be called with increasing indices */
+	inline bool isEdge(int64 sampleIndex)
+	{
+		if (sampleIndex < nextEdgeSample)
+			return false;
+
+		edgeIndex++;
+		nextEdgeSample = anchorSample + edgeOffset(edgeIndex);
+
+		return true;
+	}
+
+	int64 getNextEdgeSample() const { return nextEdgeSample; }
+
+	/** Moves the schedule forward to the first edge at or after sampleIndex, as if every sample
+		since the anchor had been checked; returns the number of edges skipped */
+	int64 seek(int64 sampleIndex)
+	{
+		const int64 firstIndex = edgeIndex;
+
+		if (tolerance == 0.0)
+		{
+			//First k with ceil(k * num / den) >= sampleIndex - anchor
+			const int64 distance = sampleIndex - anchorSample;
+			const int64 k = distance > 0 ? (distance - 1) * halfDen / halfNum + 1 : 1;
+
+			if (k > edgeIndex)
+			{
+				edgeIndex = k;
+				nextEdgeSample = anchorSample + edgeOffset(edgeIndex);
+			}
+		}
+		else
+		{
+			//The random walk has to be replayed edge by edge to stay reproducible
+			while (nextEdgeSample < sampleIndex)
+			{
+				edgeIndex++;
+				nextEdgeSample = anchorSample + edgeOffset(edgeIndex);
+			}
+		}
+
+		return edgeIndex - firstIndex;
+	}
+
+private:
+
+	int64 edgeOffset(int64 k)
+	{
+		//Exact whole samples of k * num / den; only the fraction and the error terms are floating point
+		const int64 whole = k * halfNum / halfDen;
+		const int64 remainder = k * halfNum % halfDen;
+
+		if (tolerance == 0.0)
+			return whole + (remainder != 0 ? 1 : 0);
+
+		//Bounded random walk of the frequency error around the fixed offset
+		walk += tolerance * CLK_WALK_SHARE * CLK_WALK_STEP * (2.0 * random.nextDouble() - 1.0);
+		walk = jlimit(-tolerance * CLK_WALK_SHARE, tolerance * CLK_WALK_SHARE, walk);
+
+		driftOffset += halfPeriod * (drift + walk);
+
+		double jitter = halfPeriod * tolerance * CLK_JITTER_SHARE * (2.0 * random.nextDouble() - 1.0);
+
+		return whole + (int64) std::ceil((double) remainder / (double) halfDen + driftOffset + jitter);
+	}
+
+	/* Half period in samples, exactly halfNum / halfDen (reduced) and approximately halfPeriod */
+	double halfPeriod;
+	int64 halfNum;
+	int64 halfDen;
+	int64 anchorSample;
+	int64 edgeIndex;
+	int64 nextEdgeSample;
+
+	double tolerance;
+	double drift;
+	double walk;
+	double driftOffset;
+
+	Philox random;
+
+};
+
+#endif